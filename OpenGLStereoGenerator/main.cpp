@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <fstream>
@@ -45,7 +46,7 @@ struct WarpUniforms {
 } warpU;
 
 struct TileUniforms {
-  GLint orgWidth, orgHeight, eyeSign;
+  GLint orgWidth, orgHeight, eyeSign, maxHole, selfClear, clearColor;
 } tileU;
 
 /* ----------------------- 工具：读文件 ------------------------- */
@@ -78,10 +79,24 @@ static GLuint compileShader(GLenum type, const std::string &source) {
   return shader;
 }
 
-static GLuint createComputeProgram(const char *path) {
+// warp_depth / warp_color 竞争键的深度位数（8..16，其余低位放源列号），编译时以 #define DEPTH_BITS 注入
+static const int kDepthBits = 16;
+static_assert(kDepthBits >= 8 && kDepthBits <= 16, "key index bits must hold any row width");
+// true 时用单趟 gather warp（warp_gather_gl.comp，无原子操作、无需清零深度）替代 warp_depth + warp_color，
+// 结果逐位一致；只支持水平视差（yScale = 0）
+static const bool kUseGather = false;
+// true 时 fill 自清零：消费完竞争键 / 索引后写回 0 / UNDEF，颜色按 warp 目标 + fill 输出双缓冲，
+// 循环里不再 resetTargets（每帧省掉六张纹理的 FBO 清零）；输出与每帧清零逐位一致
+static const bool kSelfClear = true;
+
+// defines 插在 #version 之后（#version 必须是第一条语句）
+static GLuint createComputeProgram(const char *path, const std::string &defines = "") {
   std::string code = loadFile(path);
   if (code.empty())
     return 0;
+  size_t eol = code.find('\n');
+  if (!defines.empty() && eol != std::string::npos)
+    code = code.substr(0, eol + 1) + defines + "#line 2\n" + code.substr(eol + 1);
   GLuint cs = compileShader(GL_COMPUTE_SHADER, code);
   GLuint prog = glCreateProgram();
   glAttachShader(prog, cs);
@@ -117,32 +132,42 @@ static GLuint loadTextureFromPNG(const char *path, int &width, int &height) {
   return tex;
 }
 
+// 保存用的打包程序（根目录的 pack_output.comp，构建时拷贝到可执行文件旁；PACK_FORMAT 1 = 紧密 RGB888），第一次保存时编译
+static GLuint gPackRGBProg = 0;
+
+// 在 GPU 上把左上角 w x h 的 RGBA8 打包成 RGB888 写进缓冲对象再读回：
+// 读回少 1/4，也不再在 CPU 上逐像素转 RGB。调用前纹理的写入须以 GL_TEXTURE_FETCH_BARRIER_BIT 隔开
 static void saveTexturePNG(GLuint tex, int w, int h, const char *name) {
-  GLuint fbo = 0;
-  glGenFramebuffers(1, &fbo);
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                         tex, 0);
-  GLenum st = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-  if (st != GL_FRAMEBUFFER_COMPLETE) {
-    LOGE("FBO incomplete: 0x%04X", st);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glDeleteFramebuffers(1, &fbo);
+  if (!gPackRGBProg)
+    gPackRGBProg = createComputeProgram("pack_output.comp", "#define PACK_FORMAT 1\n");
+  if (!gPackRGBProg) {
+    LOGE("Failed to create pack program, %s not saved", name);
     return;
   }
-  std::vector<unsigned char> rgba(w * h * 4);
-  glReadBuffer(GL_COLOR_ATTACHMENT0);
-  glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  glDeleteFramebuffers(1, &fbo);
-
-  // 转成 RGB 存
-  std::vector<unsigned char> rgb(w * h * 3);
-  for (int i = 0; i < w * h; ++i) {
-    rgb[i * 3 + 0] = rgba[i * 4 + 0];
-    rgb[i * 3 + 1] = rgba[i * 4 + 1];
-    rgb[i * 3 + 2] = rgba[i * 4 + 2];
-  }
+  const size_t bytes = size_t(w) * h * 3;
+  GLuint buf = 0;
+  glGenBuffers(1, &buf);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, buf);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr((bytes + 3) & ~size_t(3)), nullptr, GL_STREAM_READ);
+
+  glUseProgram(gPackRGBProg);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, tex);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buf);
+  glUniform1i(glGetUniformLocation(gPackRGBProg, "srcColor"), 0);
+  glUniform1i(glGetUniformLocation(gPackRGBProg, "width"), w);
+  glUniform1i(glGetUniformLocation(gPackRGBProg, "height"), h);
+  glUniform1ui(glGetUniformLocation(gPackRGBProg, "totalBytes"), GLuint(bytes));
+  // 每个调用写 4 字节、每组 256 个调用；组数超出 x 方向上限时折到 y
+  GLuint groups = GLuint((bytes + 1023) / 1024);
+  GLuint gx = std::min(groups, 32768u);
+  glDispatchCompute(gx, (groups + gx - 1) / gx, 1);
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+  std::vector<unsigned char> rgb(bytes);
+  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(bytes), rgb.data());
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  glDeleteBuffers(1, &buf);
   stbi_write_png(name, w, h, 3, rgb.data(), w * 3);
   LOGI("Saved: %s", name);
 }
@@ -332,15 +357,23 @@ int main() {
   auto tMake = steady_clock::now();
   makeTarget3(leftColor, leftDepth, leftIndex);
   makeTarget3(rightColor, rightDepth, rightIndex);
+  // fill 输出：自清零时与 warp 目标分开（fill 读 warp 目标、写这里），否则就是 warp 目标本身
+  GLuint leftOut = leftColor, rightOut = rightColor;
+  if (kSelfClear) {
+    allocTex2D(leftOut, GL_RGBA8, imageW, imageH);
+    allocTex2D(rightOut, GL_RGBA8, imageW, imageH);
+  }
   LOGI("Targets created in %.2f ms",
        duration_cast<milliseconds>(steady_clock::now() - tMake).count() / 1.0);
 
   // 编译 compute shader（请确保你的 .comp 文件是 GLSL 430，而不是 ESSL）
   auto tShader = steady_clock::now();
-  GLuint warpDProg = createComputeProgram("shaders/warp_depth.comp");
-  GLuint warpCProg = createComputeProgram("shaders/warp_color.comp");
+  const std::string keyDefines = "#define DEPTH_BITS " + std::to_string(kDepthBits) + "\n";
+  GLuint warpDProg = createComputeProgram("shaders/warp_depth.comp", keyDefines);
+  GLuint warpCProg = createComputeProgram("shaders/warp_color.comp", keyDefines);
   GLuint tileProg = createComputeProgram("shaders/fill_tile_gl.comp");
-  if (!warpDProg || !warpCProg || !tileProg) {
+  GLuint gatherProg = kUseGather ? createComputeProgram("shaders/warp_gather_gl.comp", keyDefines) : 0;
+  if (!warpDProg || !warpCProg || !tileProg || (kUseGather && !gatherProg)) {
     LOGE("Failed to create compute programs");
     cleanupOpenGL();
     return -1;
@@ -351,18 +384,21 @@ int main() {
   tileU.orgWidth = glGetUniformLocation(tileProg, "orgWidth");
   tileU.orgHeight = glGetUniformLocation(tileProg, "orgHeight");
   tileU.eyeSign = glGetUniformLocation(tileProg, "eyeSign");
+  tileU.maxHole = glGetUniformLocation(tileProg, "maxHole");
+  tileU.selfClear = glGetUniformLocation(tileProg, "selfClear");
+  tileU.clearColor = glGetUniformLocation(tileProg, "clearColor");
 
   LOGI("Shaders ready in %.2f ms",
        duration_cast<milliseconds>(steady_clock::now() - tShader).count() /
            1.0);
 
   // -----------------------------------------------------
-  //  扭曲（warp）函数：两次 Dispatch
-  //      • pass-1  : 统计最大深度   (warpDProg)
-  //      • pass-2  : 填充颜色/索引 (warpCProg)
+  //  扭曲（warp）函数：单眼的一趟 Dispatch，不发 barrier（由 warpBoth 统一隔开）
+  //      • pass 0 : 统计最大深度   (warpDProg)；gather 时为整个 warp
+  //      • pass 1 : 填充颜色/索引 (warpCProg)；gather 时为空
   // -----------------------------------------------------
   auto warpEye = [&](GLuint dstC, GLuint dstD, GLuint dstI, float xScale,
-                     float yScale) {
+                     float yScale, int pass) {
     // ------------- 通用准备 ----------------------------
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, imageTex); // srcColor = binding0
@@ -388,21 +424,37 @@ int main() {
       glUniform1f(glGetUniformLocation(prog, "shiftBiasY"), shiftBiasY);
     };
 
+    // ==================================================
+    //  gather：单趟，每个工作组负责一行 256 个目标像素
+    // ==================================================
+    if (kUseGather) {
+      if (pass != 0) return;
+      glUseProgram(gatherProg);
+      glBindImageTexture(2, dstC, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+      glBindImageTexture(4, dstI, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32UI);
+      setCommonUniforms(gatherProg);
+      glUniform1i(glGetUniformLocation(gatherProg, "indexOnly"), 0);
+      glDispatchCompute((GLuint)((imageW + 255) / 256), (GLuint)imageH, 1);
+      return;
+    }
+
     GLuint gx = (GLuint)((paddedW + 15) / 16);
     GLuint gy = (GLuint)((paddedH + 15) / 16);
 
     // ==================================================
     //  Pass-1 : 最大深度（warpDProg）
     // ==================================================
-    glUseProgram(warpDProg);
+    if (pass == 0) {
+      glUseProgram(warpDProg);
 
-    // 只需要 dstDepth，绑定成读写；dstColor/Index 不用绑定
-    glBindImageTexture(3, dstD, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+      // 只需要 dstDepth，绑定成读写；dstColor/Index 不用绑定
+      glBindImageTexture(3, dstD, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
 
-    setCommonUniforms(warpDProg);
+      setCommonUniforms(warpDProg);
 
-    glDispatchCompute(gx, gy, 1);
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT); // 等待所有深度写完
+      glDispatchCompute(gx, gy, 1);
+      return;
+    }
 
     // ==================================================
     //  Pass-2 : 写颜色 / 索引（warpCProg）
@@ -417,21 +469,50 @@ int main() {
     setCommonUniforms(warpCProg);
 
     glDispatchCompute(gx, gy, 1);
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT); // 若随后要采样 dstC
   };
 
-  // 填充（fill）函数
-  auto fillEye = [&](GLuint color, GLuint index, int eyeSign) {
+  float xScale = -8.0f, yScale = 0.0f;
+
+  // 两眼交错：左右眼同一趟的 dispatch 互不依赖（各自的 depth / color / index），
+  // 连续提交后只隔一次 barrier，每帧 warp 从 4 次 barrier 减到 2 次
+  auto warpBoth = [&]() {
+    warpEye(leftColor, leftDepth, leftIndex, xScale, yScale, 0);
+    warpEye(rightColor, rightDepth, rightIndex, xScale - 2.0f, yScale, 0);
+    if (!kUseGather) {
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT); // 等待两眼深度写完
+      warpEye(leftColor, leftDepth, leftIndex, xScale, yScale, 1);
+      warpEye(rightColor, rightDepth, rightIndex, xScale - 2.0f, yScale, 1);
+    }
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT); // fill 经 image 读写颜色 / 索引
+  };
+
+  // 填充（fill）函数：不发 barrier（由 fillBoth 统一隔开）
+  // 自清零时 out 为另一张颜色纹理，depth / index 处理完即复位
+  auto fillEye = [&](GLuint color, GLuint depth, GLuint index, GLuint out, int eyeSign, float xScale) {
     int numTile = (imageW + TILE_W - 1) / TILE_W;
     glUseProgram(tileProg);
     glBindImageTexture(6, color, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
-    glBindImageTexture(2, color, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    glBindImageTexture(2, out, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
     glBindImageTexture(4, index, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+    if (kSelfClear) glBindImageTexture(3, depth, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32UI);
+    glUniform1i(tileU.selfClear, kSelfClear ? 1 : 0);
+    glUniform4f(tileU.clearColor, 1.0f, 0.0f, 0.0f, 1.0f); // 与 resetTargets 清出的颜色相同
     glUniform1i(tileU.orgWidth, imageW);
     glUniform1i(tileU.orgHeight, imageH);
     glUniform1i(tileU.eyeSign, eyeSign);
+    // 传播上限：空洞不超过本眼的视差范围 |shiftScaleX|（+2 列吸收取整）
+    glUniform1i(tileU.maxHole,
+                int(std::ceil(std::fabs(divergence * 0.01f * imageW * 0.5f * xScale))) + 2);
     glDispatchCompute((GLuint)numTile, (GLuint)imageH, 1);
-    glMemoryBarrier(GL_ALL_BARRIER_BITS);
+  };
+
+  // 两眼的 fill 互不依赖，之后只需要：下一帧 warp 的 image 访问、保存 PNG 时打包着色器的采样（TEXTURE_FETCH），
+  // 不自清零时还有 resetTargets 的 FBO 清空（FRAMEBUFFER），不再用 GL_ALL_BARRIER_BITS
+  auto fillBoth = [&]() {
+    fillEye(leftColor, leftDepth, leftIndex, leftOut, +1, xScale);
+    fillEye(rightColor, rightDepth, rightIndex, rightOut, -1, xScale - 2.0f);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT |
+                    (kSelfClear ? 0 : GL_FRAMEBUFFER_BARRIER_BIT));
   };
 
   // 保存原图中左幅（验证）
@@ -455,22 +536,19 @@ int main() {
     }
   };
 
-  float xScale = -8.0f, yScale = 0.0f;
-  LOGI("Warping left...");
-  warpEye(leftColor, leftDepth, leftIndex, xScale, yScale);
-  LOGI("Warping right...");
-  warpEye(rightColor, rightDepth, rightIndex, xScale - 2.0f, yScale);
+  LOGI("Warping...");
+  warpBoth();
+  glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT); // 保存中间结果（打包着色器采样）
   saveTexturePNG(leftColor, imageW, imageH, "left_eye_warped.png");
   saveTexturePNG(rightColor, imageW, imageH, "right_eye_warped.png");
 
-  LOGI("Filling left...");
-  fillEye(leftColor, leftIndex, +1);
-  LOGI("Filling right...");
-  fillEye(rightColor, rightIndex, -1);
-  saveTexturePNG(leftColor, imageW, imageH, "left_eye_filled.png");
-  saveTexturePNG(rightColor, imageW, imageH, "right_eye_filled.png");
+  LOGI("Filling...");
+  fillBoth();
+  saveTexturePNG(leftOut, imageW, imageH, "left_eye_filled.png");
+  saveTexturePNG(rightOut, imageW, imageH, "right_eye_filled.png");
 
-  resetTargets();
+  if (!kSelfClear)
+    resetTargets();
   glFinish();
 
   // 性能测试
@@ -479,19 +557,17 @@ int main() {
   auto tPerf = steady_clock::now();
   for (int i = 0; i < TEST_ITERATIONS; ++i) {
     auto t0 = steady_clock::now();
-    warpEye(leftColor, leftDepth, leftIndex, xScale, yScale);
-    warpEye(rightColor, rightDepth, rightIndex, xScale - 2.0f, yScale);
+    warpBoth();
     // std::string name = "left_eye_warped_" + std::to_string(i) + ".png";
     // saveTexturePNG(leftColor, imageW, imageH, name.c_str());
     // name = "right_eye_warped_" + std::to_string(i) + ".png";
     // saveTexturePNG(rightColor, imageW, imageH, name.c_str());
-    fillEye(leftColor, leftIndex, +1);
-    fillEye(rightColor, rightIndex, -1);
+    fillBoth();
     // name = "left_eye_filled_" + std::to_string(i) + ".png";
     // saveTexturePNG(leftColor, imageW, imageH, name.c_str());
     // name = "right_eye_filled_" + std::to_string(i) + ".png";
     // saveTexturePNG(rightColor, imageW, imageH, name.c_str());
-    if (i < TEST_ITERATIONS - 1)
+    if (!kSelfClear && i < TEST_ITERATIONS - 1)
       resetTargets();
     glFinish();
     auto us = duration_cast<std::chrono::microseconds>(steady_clock::now() - t0)
@@ -512,8 +588,8 @@ int main() {
   LOGI("Average: %.2f ms", avgUs / 1000.0);
 
   // 保存最终结果
-  saveTexturePNG(leftColor, imageW, imageH, "left_eye_result.png");
-  saveTexturePNG(rightColor, imageW, imageH, "right_eye_result.png");
+  saveTexturePNG(leftOut, imageW, imageH, "left_eye_result.png");
+  saveTexturePNG(rightOut, imageW, imageH, "right_eye_result.png");
 
   // 清理
   glDeleteTextures(1, &imageTex);
@@ -523,9 +599,15 @@ int main() {
   glDeleteTextures(1, &rightColor);
   glDeleteTextures(1, &rightDepth);
   glDeleteTextures(1, &rightIndex);
+  if (kSelfClear) {
+    glDeleteTextures(1, &leftOut);
+    glDeleteTextures(1, &rightOut);
+  }
   glDeleteProgram(warpDProg);
   glDeleteProgram(warpCProg);
   glDeleteProgram(tileProg);
+  if (gatherProg) glDeleteProgram(gatherProg);
+  if (gPackRGBProg) glDeleteProgram(gPackRGBProg);
 
   cleanupOpenGL();
   auto totalMs =
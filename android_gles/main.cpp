@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <android/log.h>
 #include <chrono>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -45,7 +46,7 @@ struct WarpUniforms {
 } warpU;
 
 struct TileUniforms {
-  GLint orgWidth, orgHeight, eyeSign;
+  GLint orgWidth, orgHeight, eyeSign, maxHole, selfClear, clearColor;
 } tileU;
 
 // 着色器编译函数
@@ -114,13 +115,23 @@ GLuint createShaderProgram(const char *vertexPath, const char *fragmentPath) {
   return program;
 }
 
-// 创建计算着色器程序
-GLuint createComputeProgram(const char *path) {
+// warp_depth / warp_color 竞争键的深度位数（8..16，其余低位放源列号），编译时以 #define DEPTH_BITS 注入
+static const int kDepthBits = 16;
+static_assert(kDepthBits >= 8 && kDepthBits <= 16, "key index bits must hold any row width");
+// true 时 fill 自清零：消费完竞争键 / 索引后写回 0 / UNDEF，颜色按 warp 目标 + fill 输出双缓冲，
+// 循环里不再 resetTargets（每帧省掉六张纹理的 FBO 清零）；输出与每帧清零逐位一致
+static const bool kSelfClear = true;
+
+// 创建计算着色器程序，defines 插在 #version 之后（#version 必须是第一条语句）
+GLuint createComputeProgram(const char *path, const std::string &defines = "") {
   std::string code = loadFile(path);
   if (code.empty()) {
     LOGE("Failed to load compute shader: %s", path);
     return 0;
   }
+  size_t eol = code.find('\n');
+  if (!defines.empty() && eol != std::string::npos)
+    code = code.substr(0, eol + 1) + defines + "#line 2\n" + code.substr(eol + 1);
 
   GLuint cs = compileShader(GL_COMPUTE_SHADER, code);
   GLuint prog = glCreateProgram();
@@ -638,6 +649,12 @@ int main() {
   auto makeTargetStart = steady_clock::now();
   makeTarget3(leftColor, leftDepth, leftIndex);
   makeTarget3(rightColor, rightDepth, rightIndex);
+  // fill 输出：自清零时与 warp 目标分开（fill 读 warp 目标、写这里），否则就是 warp 目标本身
+  GLuint leftOut = leftColor, rightOut = rightColor;
+  if (kSelfClear) {
+    allocTex2D(leftOut, GL_RGBA8, imageW, imageH);
+    allocTex2D(rightOut, GL_RGBA8, imageW, imageH);
+  }
   auto makeTargetTime =
       duration_cast<milliseconds>(steady_clock::now() - makeTargetStart)
           .count();
@@ -645,8 +662,9 @@ int main() {
 
   // 编译着色器
   auto shaderStart = steady_clock::now();
-  GLuint warpDProg = createComputeProgram("shaders/warp_depth.comp");
-  GLuint warpCProg = createComputeProgram("shaders/warp_color.comp");
+  const std::string keyDefines = "#define DEPTH_BITS " + std::to_string(kDepthBits) + "\n";
+  GLuint warpDProg = createComputeProgram("shaders/warp_depth.comp", keyDefines);
+  GLuint warpCProg = createComputeProgram("shaders/warp_color.comp", keyDefines);
   loadFileTest("shaders/warp_depth.comp");
   loadFileTest("shaders/warp_color.comp");
   GLuint tileProg = createComputeProgram("shaders/fill_tile_es.comp");
@@ -670,10 +688,13 @@ int main() {
   tileU.orgWidth = glGetUniformLocation(tileProg, "orgWidth");
   tileU.orgHeight = glGetUniformLocation(tileProg, "orgHeight");
   tileU.eyeSign = glGetUniformLocation(tileProg, "eyeSign");
+  tileU.maxHole = glGetUniformLocation(tileProg, "maxHole");
+  tileU.selfClear = glGetUniformLocation(tileProg, "selfClear");
+  tileU.clearColor = glGetUniformLocation(tileProg, "clearColor");
 
   LOGI("xptest: Tile uniform locations:");
-  LOGI("xptest:   orgWidth=%d, orgHeight=%d, eyeSign=%d", tileU.orgWidth,
-       tileU.orgHeight, tileU.eyeSign);
+  LOGI("xptest:   orgWidth=%d, orgHeight=%d, eyeSign=%d, maxHole=%d",
+       tileU.orgWidth, tileU.orgHeight, tileU.eyeSign, tileU.maxHole);
 
   auto shaderTime =
       duration_cast<milliseconds>(steady_clock::now() - shaderStart).count();
@@ -749,7 +770,8 @@ int main() {
   };
 
   // 填充处理函数
-  auto fillEye = [&](GLuint color, GLuint index, int eyeSign) {
+  // 自清零时 out 为另一张颜色纹理，depth / index 处理完即复位
+  auto fillEye = [&](GLuint color, GLuint depth, GLuint index, GLuint out, int eyeSign, float xScale) {
     int numTile = (imageW + TILE_W - 1) / TILE_W;
 
     // 检查硬件上限
@@ -764,18 +786,27 @@ int main() {
     glUseProgram(tileProg);
 
     // 写（binding = 2）
-    glBindImageTexture(2, color, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    glBindImageTexture(2, out, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
     // 读（binding = 6）
     glBindImageTexture(6, color, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
     glBindImageTexture(4, index, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+    if (kSelfClear)
+      glBindImageTexture(3, depth, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32UI);
 
     // 使用缓存的 uniform 位置
     glUniform1i(tileU.orgWidth, imageW);
     glUniform1i(tileU.orgHeight, imageH);
     glUniform1i(tileU.eyeSign, eyeSign);
+    // 传播上限：空洞不超过本眼的视差范围 |shiftScaleX|（+2 列吸收取整）
+    glUniform1i(tileU.maxHole,
+                int(std::ceil(std::fabs(divergence * 0.01f * imageW * 0.5f * xScale))) + 2);
+    glUniform1i(tileU.selfClear, kSelfClear ? 1 : 0);
+    glUniform4f(tileU.clearColor, 1.0f, 0.0f, 0.0f, 1.0f); // 与 resetTargets 清出的颜色相同
 
     glDispatchCompute(numTile, imageH, 1);
-    glMemoryBarrier(GL_ALL_BARRIER_BITS);
+    // 之后只有下一趟 image 访问和帧缓冲访问：保存 PNG 经 FBO 附件 glReadPixels 读回，resetTargets 经 FBO 清空。
+    // 自清零时不再 resetTargets，但读回仍是帧缓冲读取，FRAMEBUFFER 位不能省（ES 没有 glGetTexImage，不需要 TEXTURE_UPDATE）
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
   };
   saveTexturePNG(imageTex, imageW, imageH, "image.png");
 
@@ -814,12 +845,14 @@ int main() {
 
   // 执行填充 - 先跑一次正常流程
   LOGI("xptest: Filling left eye...");
-  fillEye(leftColor, leftIndex, +1);
+  fillEye(leftColor, leftDepth, leftIndex, leftOut, +1, xScale);
   LOGI("xptest: Filling right eye...");
-  fillEye(rightColor, rightIndex, -1);
-  saveTexturePNG(leftColor, imageW, imageH, "left_eye_filled.png");
-  saveTexturePNG(rightColor, imageW, imageH, "right_eye_filled.png");
-  resetTargets();
+  fillEye(rightColor, rightDepth, rightIndex, rightOut, -1, xScale - 2.0f);
+  saveTexturePNG(leftOut, imageW, imageH, "left_eye_filled.png");
+  saveTexturePNG(rightOut, imageW, imageH, "right_eye_filled.png");
+  if (!kSelfClear) {
+    resetTargets();
+  }
   glFinish();
 
   // 数据恢复函数 - 使用 Compute Shader
@@ -873,11 +906,11 @@ int main() {
     // ---------- 1. 扭曲 + 填充 ----------
     warpEye(leftColor, leftDepth, leftIndex, xScale, yScale);
     warpEye(rightColor, rightDepth, rightIndex, xScale - 2.0f, yScale);
-    fillEye(leftColor, leftIndex, +1);
-    fillEye(rightColor, rightIndex, -1);
+    fillEye(leftColor, leftDepth, leftIndex, leftOut, +1, xScale);
+    fillEye(rightColor, rightDepth, rightIndex, rightOut, -1, xScale - 2.0f);
 
-    // ---------- 3. 恢复数据 ----------
-    if (i < TEST_ITERATIONS - 1) {
+    // ---------- 3. 恢复数据（自清零时 fill 已复位）----------
+    if (!kSelfClear && i < TEST_ITERATIONS - 1) {
       resetTargets();
     }
     glFinish();
@@ -906,8 +939,8 @@ int main() {
        pipelineAvgTime / 1000.0);
 
   // 保存最终结果
-  saveTexturePNG(leftColor, imageW, imageH, "left_eye_result.png");
-  saveTexturePNG(rightColor, imageW, imageH, "right_eye_result.png");
+  saveTexturePNG(leftOut, imageW, imageH, "left_eye_result.png");
+  saveTexturePNG(rightOut, imageW, imageH, "right_eye_result.png");
 
   // 清理资源
   glDeleteTextures(1, &imageTex);
@@ -918,6 +951,10 @@ int main() {
   glDeleteTextures(1, &rightColor);
   glDeleteTextures(1, &rightDepth);
   glDeleteTextures(1, &rightIndex);
+  if (kSelfClear) {
+    glDeleteTextures(1, &leftOut);
+    glDeleteTextures(1, &rightOut);
+  }
   glDeleteProgram(warpDProg);
   glDeleteProgram(warpCProg);
   glDeleteProgram(tileProg);
@@ -0,0 +1,350 @@
+// stereogen_batch：多上下文批处理
+// 每个工作线程持有独立的 GL 上下文和 StereoPipeline，任务经工作窃取队列分配：
+// 每张图先是一个解码任务，大图再拆成若干行条带任务（warp / fill 都只在行内进行，条带结果与整图逐位一致），
+// 这样 8K 大图不会让其他线程在小图做完后空等。结束时打印每个工作线程的利用率
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gl_utils.h"
+#include "stb_image.h"
+#include "stb_image_write.h"
+#include "stereo_pipeline.h"
+#include "synthetic_scenes.h"
+#include "task_scheduler.h"
+#include "trace.h"
+
+struct BatchOptions {
+    std::string list;      // 每行：color.png depth.exr left.png right.png
+    std::vector<std::string> synthetic; // 合成场景分辨率（720p,1080p,4k,8k 或 WxH）
+    std::string outDir;    // 合成场景的输出目录，为空时不写文件
+    std::string shaderDir;
+    std::string trace;
+    int workers = 0;       // 0：取硬件线程数，最多 4
+    int stripeRows = 540;  // 条带高度，0 表示不拆分
+    StereoParams params;
+};
+
+struct BatchJob {
+    std::string name;
+    std::string colorPath, depthPath, leftPath, rightPath;
+    int synthW = 0, synthH = 0;
+
+    RGBDImage image;
+    std::vector<uint8_t> left, right; // RGB8 结果
+    std::atomic<int> stripesLeft{0};
+    bool failed = false;
+    bool finished = false; // 已经过 encodeJob；工作线程全部初始化失败时任务不会运行
+};
+
+struct WorkerContext {
+    GLFWwindow *window = nullptr;
+    StereoPipeline pipeline;
+    long long pixels = 0;
+};
+
+static std::vector<std::string> splitList(const std::string &s) {
+    std::vector<std::string> items;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty()) items.push_back(item);
+    return items;
+}
+
+static bool parseResolution(const std::string &name, int &w, int &h) {
+    static const struct {
+        const char *name;
+        int w, h;
+    } kNamed[] = {{"720p", 1280, 720}, {"1080p", 1920, 1080}, {"1440p", 2560, 1440}, {"4k", 3840, 2160},
+                  {"8k", 7680, 4320}};
+    for (const auto &r : kNamed) {
+        if (name == r.name) {
+            w = r.w;
+            h = r.h;
+            return true;
+        }
+    }
+    return std::sscanf(name.c_str(), "%dx%d", &w, &h) == 2 && w > 0 && h > 0;
+}
+
+static void printUsage() {
+    std::cout << "Usage: stereogen_batch [options]\n"
+              << "  --list FILE         jobs, one per line: color.png depth.exr left.png right.png\n"
+              << "  --synthetic LIST    synthetic jobs by resolution (720p,1080p,1440p,4k,8k or WxH)\n"
+              << "  --out-dir DIR       write synthetic results to DIR (default: discard)\n"
+              << "  --workers N         worker threads, each with its own GL context (default min(cores, 4))\n"
+              << "  --stripe ROWS       split images taller than ROWS into row stripes (default 540, 0 = off)\n"
+              << "  --div X             divergence in % (default 2)\n"
+              << "  --conv X            convergence (default 0)\n"
+              << "  --shaders DIR       shader directory (default: working directory)\n"
+              << "  --trace FILE        write a Chrome trace JSON (or set STEREOGEN_TRACE)\n";
+}
+
+static bool parseOptions(int argc, char **argv, BatchOptions &opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return false;
+        } else if (arg == "--list" && hasValue) {
+            opt.list = argv[++i];
+        } else if (arg == "--synthetic" && hasValue) {
+            opt.synthetic = splitList(argv[++i]);
+        } else if (arg == "--out-dir" && hasValue) {
+            opt.outDir = argv[++i];
+        } else if (arg == "--workers" && hasValue) {
+            opt.workers = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--stripe" && hasValue) {
+            opt.stripeRows = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--div" && hasValue) {
+            opt.params.divergence = std::strtof(argv[++i], nullptr);
+        } else if (arg == "--conv" && hasValue) {
+            opt.params.convergence = std::strtof(argv[++i], nullptr);
+        } else if (arg == "--shaders" && hasValue) {
+            opt.shaderDir = argv[++i];
+        } else if (arg == "--trace" && hasValue) {
+            opt.trace = argv[++i];
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            printUsage();
+            return false;
+        }
+    }
+    if (opt.list.empty() && opt.synthetic.empty()) {
+        printUsage();
+        return false;
+    }
+    if (opt.workers == 0) opt.workers = int(std::min(4u, std::max(1u, std::thread::hardware_concurrency())));
+    return true;
+}
+
+static bool loadJobs(const BatchOptions &opt, std::vector<std::unique_ptr<BatchJob>> &jobs) {
+    if (!opt.list.empty()) {
+        std::ifstream f(opt.list);
+        if (!f) {
+            std::cerr << "Cannot open job list: " << opt.list << std::endl;
+            return false;
+        }
+        std::string line;
+        while (std::getline(f, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            auto job = std::make_unique<BatchJob>();
+            std::istringstream in(line);
+            if (!(in >> job->colorPath >> job->depthPath >> job->leftPath >> job->rightPath)) {
+                std::cerr << "Bad job line: " << line << std::endl;
+                return false;
+            }
+            job->name = job->colorPath;
+            jobs.push_back(std::move(job));
+        }
+    }
+    for (size_t i = 0; i < opt.synthetic.size(); ++i) {
+        auto job = std::make_unique<BatchJob>();
+        if (!parseResolution(opt.synthetic[i], job->synthW, job->synthH)) {
+            std::cerr << "Unknown resolution: " << opt.synthetic[i] << std::endl;
+            return false;
+        }
+        job->name = "synthetic_" + std::to_string(i) + "_" + opt.synthetic[i];
+        if (!opt.outDir.empty()) {
+            job->leftPath = opt.outDir + "/" + job->name + "_left.png";
+            job->rightPath = opt.outDir + "/" + job->name + "_right.png";
+        }
+        jobs.push_back(std::move(job));
+    }
+    return true;
+}
+
+static bool decodeJob(BatchJob &job) {
+    TRACE_SCOPE("decode");
+    if (job.synthW > 0) {
+        job.image = generateScene(SceneKind::Occlusion, job.synthW, job.synthH);
+        return true;
+    }
+    int w, h, n;
+    unsigned char *data = stbi_load(job.colorPath.c_str(), &w, &h, &n, 3);
+    if (!data) {
+        std::cerr << "Failed to load image: " << job.colorPath << std::endl;
+        return false;
+    }
+    job.image.width = w;
+    job.image.height = h;
+    job.image.rgb.assign(data, data + size_t(w) * h * 3);
+    stbi_image_free(data);
+
+    int dw, dh;
+    if (!readDepthEXR(job.depthPath.c_str(), job.image.depth, dw, dh)) return false;
+    if (dw != w || dh != h) {
+        std::cerr << job.name << ": depth size " << dw << "x" << dh << " != color size " << w << "x" << h
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static void encodeJob(BatchJob &job) {
+    if (!job.failed && !job.leftPath.empty()) {
+        TRACE_SCOPE("encode");
+        int w = job.image.width, h = job.image.height;
+        stbi_write_png(job.leftPath.c_str(), w, h, 3, job.left.data(), w * 3);
+        stbi_write_png(job.rightPath.c_str(), w, h, 3, job.right.data(), w * 3);
+    }
+    // 结果写出后立即释放，批量很大时内存不随任务数增长
+    job.image = RGBDImage();
+    std::vector<uint8_t>().swap(job.left);
+    std::vector<uint8_t>().swap(job.right);
+    job.finished = true;
+}
+
+// 在当前工作线程的上下文中处理 [y0, y1) 行，结果写入整图对应行
+static void processStripe(WorkerContext &ctx, const StereoParams &params, BatchJob &job, int y0, int y1) {
+    TRACE_SCOPE("stripe");
+    const int w = job.image.width, rows = y1 - y0;
+    const size_t offset = size_t(y0) * w;
+
+    GLuint colorTex = createColorTexture(job.image.rgb.data() + offset * 3, w, rows);
+    GLuint depthTex = createDepthTexture(job.image.depth.data() + offset, w, rows);
+
+    StereoPipeline &pipeline = ctx.pipeline;
+    if (pipeline.width() != w || pipeline.height() != rows) {
+        pipeline.allocateTargets(w, rows);
+    } else {
+        pipeline.resetTargets();
+    }
+    pipeline.setParams(params);
+    pipeline.setSource(colorTex, depthTex);
+    pipeline.warp();
+    pipeline.fill();
+
+    {
+        TRACE_SCOPE("readback");
+        pipeline.readOutput(job.left.data() + offset * 3, job.right.data() + offset * 3);
+    }
+    glDeleteTextures(1, &colorTex);
+    glDeleteTextures(1, &depthTex);
+    ctx.pixels += (long long)w * rows;
+}
+
+int main(int argc, char **argv) {
+    BatchOptions opt;
+    if (!parseOptions(argc, argv, opt)) {
+        return -1;
+    }
+    std::vector<std::unique_ptr<BatchJob>> jobs;
+    if (!loadJobs(opt, jobs)) {
+        return -1;
+    }
+
+    traceInit(opt.trace);
+    if (!createOffscreenContext(false)) {
+        return -1;
+    }
+
+    // GLFW 要求窗口在主线程创建；各上下文不共享对象：uniform 属于程序对象，
+    // 多线程同时设置同一程序的 uniform 会互相覆盖，所以每个工作线程编译自己的程序
+    std::vector<WorkerContext> workers(opt.workers);
+    for (WorkerContext &ctx : workers) {
+        ctx.window = createWorkerContext();
+        if (!ctx.window) {
+            glfwTerminate();
+            return -1;
+        }
+    }
+    glfwMakeContextCurrent(nullptr);
+
+    TaskScheduler scheduler(opt.workers);
+    const StereoParams params = opt.params;
+    const int stripeRows = opt.stripeRows;
+    std::atomic<int> failures{0};
+
+    for (auto &jobPtr : jobs) {
+        BatchJob *job = jobPtr.get();
+        scheduler.submit([&, job](int worker) {
+            if (!decodeJob(*job)) {
+                job->failed = true;
+                failures++;
+                encodeJob(*job);
+                return;
+            }
+            const int w = job->image.width, h = job->image.height;
+            job->left.resize(size_t(w) * h * 3);
+            job->right.resize(size_t(w) * h * 3);
+
+            int stripes = stripeRows > 0 ? (h + stripeRows - 1) / stripeRows : 1;
+            if (stripes <= 1) {
+                processStripe(workers[worker], params, *job, 0, h);
+                encodeJob(*job);
+                return;
+            }
+            // 拆成条带放进本线程的队列，空闲线程从队首偷走；最后完成的条带负责编码
+            job->stripesLeft = stripes;
+            for (int s = 0; s < stripes; ++s) {
+                int y0 = s * stripeRows, y1 = std::min(h, y0 + stripeRows);
+                scheduler.submit([&, job, y0, y1](int stripeWorker) {
+                    processStripe(workers[stripeWorker], params, *job, y0, y1);
+                    if (--job->stripesLeft == 0) encodeJob(*job);
+                });
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    scheduler.run(
+        [&](int i) {
+            glfwMakeContextCurrent(workers[i].window);
+            // 输出只需要 RGB：fill 末尾在 GPU 上打包，直接读回到任务的输出缓冲
+            if (!workers[i].pipeline.loadPrograms(WarpVariant::Scatter, FillVariant::TilePrefix, opt.shaderDir) ||
+                !workers[i].pipeline.setOutputFormat(OutputFormat::RGB)) {
+                std::cerr << "worker " << i << ": shader compilation failed" << std::endl;
+                return false;
+            }
+            return true;
+        },
+        [&](int i) {
+            glFinish();
+            workers[i].pipeline.release();
+            traceFlushGpu();
+            glfwMakeContextCurrent(nullptr);
+        });
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    // 没有可用的工作线程（如 --shaders 指错）时任务留在队列里，同样计为失败
+    int unprocessed = 0;
+    for (const auto &job : jobs)
+        if (!job->finished) unprocessed++;
+    failures += unprocessed;
+
+    // 每个工作线程的利用率：执行任务的时间 / 线程存活时间
+    long long totalPixels = 0;
+    std::cout << "=== Worker Utilization ===" << std::endl;
+    for (int i = 0; i < scheduler.workerCount(); ++i) {
+        const TaskScheduler::WorkerStats &s = scheduler.stats()[i];
+        totalPixels += workers[i].pixels;
+        char line[160];
+        std::snprintf(line, sizeof(line), "worker %d: %4d tasks (%3d stolen)  busy %9.1f ms  util %5.1f%%  %7.1f Mpix%s",
+                      i, s.tasks, s.stolen, s.busyMs, s.utilization() * 100.0, workers[i].pixels / 1e6,
+                      s.ready ? "" : "  [init failed]");
+        std::cout << line << std::endl;
+    }
+    std::cout << jobs.size() << " images, " << failures << " failed";
+    if (unprocessed > 0) std::cout << " (" << unprocessed << " never ran)";
+    std::cout << ", wall " << wallMs << " ms, "
+              << totalPixels / 1e6 / (wallMs / 1000.0) << " Mpix/s" << std::endl;
+
+    for (WorkerContext &ctx : workers)
+        glfwDestroyWindow(ctx.window);
+    traceShutdown();
+    glfwTerminate();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,617 @@
+// stereogen_bench：合成 RGB-D 场景 × 分辨率 × 视差 × 变体 的性能扫描
+// 每个阶段用 GL_TIMESTAMP 查询计时，输出各阶段中位数 / p99 的 JSON，便于跟踪回归
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gl_utils.h"
+#include "frame_batch.h"
+#include "stereo_pipeline.h"
+#include "synthetic_scenes.h"
+#include "trace.h"
+
+// 计时阶段（与时间戳查询一一对应：upload 前 / warp 前 / fill 前 / readback 前 / 结束）
+enum Stage { STAGE_UPLOAD, STAGE_WARP, STAGE_FILL, STAGE_READBACK, STAGE_COUNT };
+static const char *kStageNames[STAGE_COUNT] = {"upload", "warp", "fill", "readback"};
+
+struct Resolution {
+    std::string name;
+    int width, height;
+};
+
+static const Resolution kResolutions[] = {
+    {"720p", 1280, 720}, {"1080p", 1920, 1080}, {"1440p", 2560, 1440}, {"4k", 3840, 2160}, {"8k", 7680, 4320},
+};
+
+struct Variant {
+    WarpVariant warp;
+    FillVariant fill;
+    ColorResolve color = ColorResolve::Eager;
+};
+
+static std::string variantName(const Variant &v) {
+    // 行网格没有 fill，名称里省略
+    std::string name = v.warp == WarpVariant::Mesh ? variantName(v.warp)
+                                                   : std::string(variantName(v.warp)) + "+" + variantName(v.fill);
+    return v.color == ColorResolve::Eager ? name : name + "+" + variantName(v.color);
+}
+
+// 每个输出像素、每只眼在各阶段读写的纹理 / 图像字节数（按着色器的访问模式估算，RGB8 源按 4 字节计；
+// 不含 tile 边缘和前缀传播里只落在空洞 tile 上的访问）。与 GPU 时间相除得到有效带宽
+struct PixelTraffic {
+    int warp = 0, fill = 0;
+};
+
+static PixelTraffic pixelTraffic(const Variant &v) {
+    PixelTraffic t;
+    bool eager = v.color == ColorResolve::Eager;
+    if (v.warp == WarpVariant::Scatter) {
+        // warp.comp：深度 4 + 两次 atomicMax 读改写 2x8；回填：键 4 + 索引 4，即时取色再加原图 4 + 颜色 4
+        t.warp = 20 + 8 + (eager ? 8 : 0);
+        if (v.color == ColorResolve::Splat) {
+            // warp_splat：深度 4 + 原图 4 + 两次读键 2x4 + 两个目标各 4 次 atomicAdd 8x8；
+            // 归一化：累加读写 2x16 + 键 4 + 颜色 4 + 索引 4（取代上面的回填）
+            t.warp = 20 + 80 + 44;
+        }
+    } else if (v.warp == WarpVariant::Gather || v.warp == WarpVariant::SplitGather ||
+               v.warp == WarpVariant::RowScatter) {
+        // warp_gather / warp_row：每个目标像素摊到约 1 次深度读 4（窗口 / apron 多出的 |视差| 列不计）+ 写索引 4，
+        // 即时取色再加原图 4 + 颜色 4；没有竞争键纹理和全局原子操作
+        t.warp = 8 + (eager ? 8 : 0);
+    } else if (v.warp == WarpVariant::Mesh) {
+        // warp_mesh：每列上下两个顶点各读两次深度 4x4，深度测试读写 8、写索引 4，即时取色再加原图 4 + 颜色 4；
+        // 没有 fill（延迟取色只剩 gather）
+        t.warp = 16 + 8 + 4 + (eager ? 8 : 0);
+        if (!eager) t.fill = 12 + (v.color == ColorResolve::DeferredBilinear ? 20 : 0);
+        return t;
+    } else {
+        // warp_depth：深度 4 + 两次 atomicMax 2x8；warp_color：深度 4 + 两次读键 2x4 + 胜者写索引 4，
+        // 即时取色再加原图 4 + 颜色 4
+        t.warp = 20 + 16 + (eager ? 8 : 0);
+    }
+    eager = eager || v.color == ColorResolve::Splat; // splat 的 fill 与即时取色相同
+    if (v.fill == FillVariant::LogShift) {
+        t.fill = eager ? 12 : 8; // fill_tile_gl：读颜色 + 索引、写颜色；延迟取色读写索引
+    } else {
+        t.fill = eager ? 16 : 8; // fill_tile：颜色 + 索引各读写一次；延迟取色只搬运索引
+    }
+    // gather：读索引 4 + 原图 4、写颜色 4；双线性再读深度 3x4 + 两个原图采样 2x4
+    if (!eager) t.fill += 12 + (v.color == ColorResolve::DeferredBilinear ? 20 : 0);
+    return t;
+}
+
+struct BenchOptions {
+    std::string out = "bench.json";
+    std::string shaderDir;
+    std::string trace; // 为空时读取 STEREOGEN_TRACE
+    int warmup = 3;
+    int iters = 20;
+    int depthBits = 16; // split 变体竞争键的深度位数
+    int batch = 0;      // > 0 时另测 K 帧一批的 scatter+tile_prefix（数组纹理）
+    bool sharedDisp = false; // scatter / split 变体开启两眼共用的视差预计算
+    DepthNormalize depthNorm = DepthNormalize::None; // 每帧 GPU 统计深度范围并归一化（SBS 输入的变体忽略）
+    OutputFormat output = OutputFormat::RGBA;        // 读回格式，非 RGBA 时 fill 末尾在 GPU 上打包
+    std::vector<Resolution> resolutions;
+    std::vector<float> divergences;
+    std::vector<SceneKind> scenes;
+    std::vector<Variant> variants;
+};
+
+static std::vector<std::string> splitList(const std::string &s) {
+    std::vector<std::string> items;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty()) items.push_back(item);
+    return items;
+}
+
+// warp+fill[+取色方式]，例如 scatter+tile_prefix、split+log_shift+deferred_bilinear；行网格为 mesh[+取色方式]
+static bool parseVariant(const std::string &name, Variant &v) {
+    std::vector<std::string> parts;
+    std::stringstream ss(name);
+    std::string part;
+    while (std::getline(ss, part, '+'))
+        parts.push_back(part);
+    if (parts.empty() || parts.size() > 3) return false;
+
+    auto match = [](const std::string &part, auto &value, std::initializer_list<std::decay_t<decltype(value)>> all) {
+        for (auto candidate : all) {
+            if (part == variantName(candidate)) {
+                value = candidate;
+                return true;
+            }
+        }
+        return false;
+    };
+    if (!match(parts[0], v.warp, {WarpVariant::Scatter, WarpVariant::SplitPass, WarpVariant::Gather,
+                                  WarpVariant::SplitGather, WarpVariant::RowScatter, WarpVariant::Mesh})) return false;
+    if (v.warp == WarpVariant::Mesh) {
+        return parts.size() == 1 ||
+               (parts.size() == 2 && match(parts[1], v.color, {ColorResolve::Deferred, ColorResolve::DeferredBilinear}));
+    }
+    if (parts.size() < 2 || !match(parts[1], v.fill, {FillVariant::TilePrefix, FillVariant::LogShift})) return false;
+    return parts.size() == 2 || match(parts[2], v.color, {ColorResolve::Deferred, ColorResolve::DeferredBilinear, ColorResolve::Splat});
+}
+
+static void printUsage() {
+    std::cout << "Usage: stereogen_bench [options]\n"
+              << "  --out FILE        JSON output (default bench.json)\n"
+              << "  --warmup N        warmup iterations per case (default 3)\n"
+              << "  --iters N         timed iterations per case (default 20)\n"
+              << "  --res LIST        720p,1080p,1440p,4k,8k or WxH (default all)\n"
+              << "  --div LIST        divergence in % (default 0.5,1,2,5,10)\n"
+              << "  --scenes LIST     plane,ramp,steps,occlusion (default all)\n"
+              << "  --variants LIST   warp+fill[+color]: scatter|split|gather|split_gather|row,\n"
+              << "                    tile_prefix|log_shift, deferred|deferred_bilinear|splat (splat: scatter only);\n"
+              << "                    mesh[+color] (no fill)\n"
+              << "                    (default scatter+tile_prefix, +deferred, +deferred_bilinear, +splat,\n"
+              << "                     split+log_shift, +deferred, gather+tile_prefix, split_gather+log_shift,\n"
+              << "                     row+tile_prefix, mesh)\n"
+              << "  --depth-bits N    depth bits of the split warp key, 8..16 (default 16)\n"
+              << "  --shared-disp     scatter / split variants decode depth once per frame into a shared disparity texture\n"
+              << "  --depth-normalize none|minmax|percentile\n"
+              << "                    per-frame GPU depth range reduction feeding warp (split variants ignore it)\n"
+              << "  --output rgba|rgb|bgra|nv12|i420\n"
+              << "                    readback format; non-RGBA formats are packed on the GPU at the end of fill\n"
+              << "                    (the pack pass counts as fill, readback times the smaller transfer)\n"
+              << "  --batch K         also time scatter+tile_prefix with K frames per array-texture batch\n"
+              << "                    (stages reported per frame; compare with scatter+tile_prefix at small --res)\n"
+              << "  --shaders DIR     shader directory (default: working directory)\n"
+              << "  --trace FILE      write a Chrome trace JSON (or set STEREOGEN_TRACE)\n";
+}
+
+static bool parseOptions(int argc, char **argv, BenchOptions &opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return false;
+        } else if (arg == "--out" && hasValue) {
+            opt.out = argv[++i];
+        } else if (arg == "--shaders" && hasValue) {
+            opt.shaderDir = argv[++i];
+        } else if (arg == "--trace" && hasValue) {
+            opt.trace = argv[++i];
+        } else if (arg == "--warmup" && hasValue) {
+            opt.warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--iters" && hasValue) {
+            opt.iters = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--depth-bits" && hasValue) {
+            opt.depthBits = std::atoi(argv[++i]);
+            if (opt.depthBits < 8 || opt.depthBits > 16) {
+                std::cerr << "Depth bits must be in 8..16: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--shared-disp") {
+            opt.sharedDisp = true;
+        } else if (arg == "--depth-normalize" && hasValue) {
+            if (!parseDepthNormalize(argv[++i], opt.depthNorm)) {
+                std::cerr << "Unknown depth normalization: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--output" && hasValue) {
+            if (!parseOutputFormat(argv[++i], opt.output)) {
+                std::cerr << "Unknown output format: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--batch" && hasValue) {
+            opt.batch = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--res" && hasValue) {
+            for (const std::string &r : splitList(argv[++i])) {
+                bool found = false;
+                for (const Resolution &known : kResolutions) {
+                    if (r == known.name) {
+                        opt.resolutions.push_back(known);
+                        found = true;
+                    }
+                }
+                int w = 0, h = 0;
+                if (!found && std::sscanf(r.c_str(), "%dx%d", &w, &h) == 2 && w > 0 && h > 0) {
+                    opt.resolutions.push_back({r, w, h});
+                    found = true;
+                }
+                if (!found) {
+                    std::cerr << "Unknown resolution: " << r << std::endl;
+                    return false;
+                }
+            }
+        } else if (arg == "--div" && hasValue) {
+            for (const std::string &d : splitList(argv[++i]))
+                opt.divergences.push_back(std::strtof(d.c_str(), nullptr));
+        } else if (arg == "--scenes" && hasValue) {
+            for (const std::string &s : splitList(argv[++i])) {
+                SceneKind kind;
+                if (!parseSceneKind(s, kind)) {
+                    std::cerr << "Unknown scene: " << s << std::endl;
+                    return false;
+                }
+                opt.scenes.push_back(kind);
+            }
+        } else if (arg == "--variants" && hasValue) {
+            for (const std::string &v : splitList(argv[++i])) {
+                Variant variant;
+                if (!parseVariant(v, variant)) {
+                    std::cerr << "Unknown variant: " << v << std::endl;
+                    return false;
+                }
+                opt.variants.push_back(variant);
+            }
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            printUsage();
+            return false;
+        }
+    }
+
+    if (opt.resolutions.empty())
+        opt.resolutions.assign(std::begin(kResolutions), std::end(kResolutions));
+    if (opt.divergences.empty())
+        opt.divergences = {0.5f, 1.0f, 2.0f, 5.0f, 10.0f};
+    if (opt.scenes.empty())
+        opt.scenes = {SceneKind::Plane, SceneKind::Ramp, SceneKind::Steps, SceneKind::Occlusion};
+    if (opt.variants.empty())
+        opt.variants = {{WarpVariant::Scatter, FillVariant::TilePrefix},
+                        {WarpVariant::Scatter, FillVariant::TilePrefix, ColorResolve::Deferred},
+                        {WarpVariant::Scatter, FillVariant::TilePrefix, ColorResolve::DeferredBilinear},
+                        {WarpVariant::Scatter, FillVariant::TilePrefix, ColorResolve::Splat},
+                        {WarpVariant::SplitPass, FillVariant::LogShift},
+                        {WarpVariant::SplitPass, FillVariant::LogShift, ColorResolve::Deferred},
+                        {WarpVariant::Gather, FillVariant::TilePrefix},
+                        {WarpVariant::SplitGather, FillVariant::LogShift},
+                        {WarpVariant::RowScatter, FillVariant::TilePrefix},
+                        {WarpVariant::Mesh, FillVariant::TilePrefix}};
+    return true;
+}
+
+// 中位数 / p99（最近秩）
+struct StageStats {
+    double median = 0, p99 = 0;
+};
+
+static StageStats computeStats(std::vector<double> v) {
+    StageStats s;
+    if (v.empty()) return s;
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    s.median = (n & 1) ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+    size_t rank = size_t(std::ceil(0.99 * n));
+    s.p99 = v[std::min(n - 1, rank ? rank - 1 : 0)];
+    return s;
+}
+
+struct CaseResult {
+    std::string variant, scene, resolution;
+    int width = 0, height = 0;
+    float divergence = 0;
+    int batch = 1;       // 每批帧数；大于 1 时各阶段为整批耗时按帧平均
+    std::string skipped; // 非空表示该用例被跳过及原因
+    PixelTraffic traffic;
+    StageStats stages[STAGE_COUNT];
+    StageStats total;
+    StageStats wall; // CPU 侧墙钟（含驱动内的同步拷贝，GPU 时间戳看不到这部分）
+};
+
+static std::string jsonEscape(const char *s) {
+    std::string out;
+    for (; s && *s; ++s) {
+        if (*s == '"' || *s == '\\') out += '\\';
+        out += *s;
+    }
+    return out;
+}
+
+static bool writeJSON(const BenchOptions &opt, const std::vector<CaseResult> &results) {
+    std::ofstream f(opt.out);
+    if (!f) {
+        std::cerr << "Cannot open output: " << opt.out << std::endl;
+        return false;
+    }
+    auto stats = [&](const StageStats &s) {
+        std::ostringstream o;
+        o << "{\"median_ms\": " << s.median << ", \"p99_ms\": " << s.p99 << "}";
+        return o.str();
+    };
+
+    f << "{\n";
+    f << "  \"device\": {\"renderer\": \"" << jsonEscape((const char *)glGetString(GL_RENDERER))
+      << "\", \"version\": \"" << jsonEscape((const char *)glGetString(GL_VERSION)) << "\"},\n";
+    f << "  \"warmup\": " << opt.warmup << ",\n";
+    f << "  \"iterations\": " << opt.iters << ",\n";
+    f << "  \"depth_bits\": " << opt.depthBits << ",\n";
+    f << "  \"shared_disparity\": " << (opt.sharedDisp ? "true" : "false") << ",\n";
+    f << "  \"depth_normalize\": \"" << variantName(opt.depthNorm) << "\",\n";
+    f << "  \"output_format\": \"" << variantName(opt.output) << "\",\n";
+    f << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const CaseResult &r = results[i];
+        f << "    {\"variant\": \"" << r.variant << "\", \"scene\": \"" << r.scene << "\", \"resolution\": \""
+          << r.resolution << "\", \"width\": " << r.width << ", \"height\": " << r.height
+          << ", \"divergence\": " << r.divergence;
+        if (r.batch > 1) f << ", \"batch\": " << r.batch;
+        if (!r.skipped.empty()) {
+            f << ", \"skipped\": \"" << r.skipped << "\"}";
+        } else {
+            f << ",\n     \"stages\": {";
+            for (int s = 0; s < STAGE_COUNT; ++s)
+                f << "\"" << kStageNames[s] << "\": " << stats(r.stages[s]) << ", ";
+            f << "\"total\": " << stats(r.total) << ", \"wall\": " << stats(r.wall) << "},\n";
+            // 有效带宽：两眼字节数 / 阶段中位数
+            double pixels = 2.0 * r.width * r.height;
+            auto gbps = [&](int bytes, const StageStats &s) { return s.median > 0 ? pixels * bytes / (s.median * 1e6) : 0; };
+            f << "     \"bytes_per_px\": {\"warp\": " << r.traffic.warp << ", \"fill\": " << r.traffic.fill
+              << "}, \"gbps\": {\"warp\": " << gbps(r.traffic.warp, r.stages[STAGE_WARP])
+              << ", \"fill\": " << gbps(r.traffic.fill, r.stages[STAGE_FILL]) << "},\n";
+            // 每百万像素（单幅输入）耗时，用于按任务选择取色方式：同场景下与 eager 相减即为质量模式的代价
+            double mpix = r.width * double(r.height) / 1e6;
+            f << "     \"ms_per_mpix\": {\"warp\": " << r.stages[STAGE_WARP].median / mpix
+              << ", \"fill\": " << r.stages[STAGE_FILL].median / mpix << ", \"total\": " << r.total.median / mpix
+              << "}}";
+        }
+        f << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    f << "  ]\n}\n";
+    return true;
+}
+
+int main(int argc, char **argv) {
+    BenchOptions opt;
+    if (!parseOptions(argc, argv, opt)) {
+        return -1;
+    }
+
+    traceInit(opt.trace);
+    if (!createOffscreenContext()) {
+        return -1;
+    }
+
+    GLint maxTexSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
+    GLint timestampBits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &timestampBits);
+    if (timestampBits == 0) {
+        std::cerr << "GL_TIMESTAMP queries not supported" << std::endl;
+        return -1;
+    }
+
+    // 每个变体只编译一次着色器
+    std::vector<StereoPipeline> pipelines(opt.variants.size());
+    for (size_t v = 0; v < opt.variants.size(); ++v) {
+        const Variant &variant = opt.variants[v];
+        pipelines[v].setDepthBits(opt.depthBits);
+        pipelines[v].setSharedDisparity(opt.sharedDisp);
+        pipelines[v].setDepthNormalize(opt.depthNorm);
+        if (!pipelines[v].loadPrograms(variant.warp, variant.fill, opt.shaderDir, ShaderDialect::Desktop, variant.color)) {
+            std::cerr << "Shader compilation failed for " << variantName(opt.variants[v]) << std::endl;
+            return -1;
+        }
+        if (!pipelines[v].setOutputFormat(opt.output)) {
+            std::cerr << "Shader compilation failed for output " << variantName(opt.output) << std::endl;
+            return -1;
+        }
+    }
+
+    FrameBatch batch;
+    if (opt.batch > 0 && !batch.loadPrograms(opt.shaderDir)) {
+        std::cerr << "Shader compilation failed for batch" << std::endl;
+        return -1;
+    }
+
+    GLuint queries[STAGE_COUNT + 1];
+    glGenQueries(STAGE_COUNT + 1, queries);
+
+    std::vector<CaseResult> results;
+    std::vector<uint8_t> readback;
+
+    for (const Resolution &res : opt.resolutions) {
+        const int w = res.width, h = res.height;
+        readback.resize(size_t(w) * h * 4);
+
+        for (SceneKind kind : opt.scenes) {
+            RGBDImage scene = generateScene(kind, w, h);
+            std::vector<uint8_t> sbs;
+
+            for (size_t v = 0; v < opt.variants.size(); ++v) {
+                const Variant &variant = opt.variants[v];
+                StereoPipeline &pipeline = pipelines[v];
+                bool split = variant.warp == WarpVariant::SplitPass || variant.warp == WarpVariant::SplitGather;
+                int srcW = split ? w * 2 : w;
+
+                CaseResult base;
+                base.variant = variantName(variant);
+                base.scene = sceneName(kind);
+                base.resolution = res.name;
+                base.width = w;
+                base.height = h;
+                base.traffic = pixelTraffic(variant);
+
+                if (srcW > maxTexSize || h > maxTexSize) {
+                    for (float div : opt.divergences) {
+                        CaseResult r = base;
+                        r.divergence = div;
+                        r.skipped = "exceeds GL_MAX_TEXTURE_SIZE";
+                        results.push_back(r);
+                    }
+                    std::cout << base.variant << " " << base.scene << " " << res.name
+                              << ": skipped (GL_MAX_TEXTURE_SIZE " << maxTexSize << ")" << std::endl;
+                    continue;
+                }
+
+                // 源纹理：Scatter 为 RGB8 + R32F，SplitPass 为 SBS RGB8；每次迭代重新上传计入 upload
+                GLuint colorTex = 0, depthTex = 0;
+                if (split) {
+                    if (sbs.empty()) sbs = packSideBySide(scene);
+                    colorTex = createColorTexture(sbs.data(), srcW, h);
+                } else {
+                    colorTex = createColorTexture(scene.rgb.data(), w, h);
+                    depthTex = createDepthTexture(scene.depth.data(), w, h);
+                }
+                auto upload = [&]() {
+                    TRACE_SCOPE("upload");
+                    TRACE_GPU_SCOPE("upload");
+                    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                    glBindTexture(GL_TEXTURE_2D, colorTex);
+                    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, srcW, h, GL_RGB, GL_UNSIGNED_BYTE,
+                                    split ? sbs.data() : scene.rgb.data());
+                    if (depthTex) {
+                        glBindTexture(GL_TEXTURE_2D, depthTex);
+                        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RED, GL_FLOAT, scene.depth.data());
+                    }
+                };
+                auto readEyes = [&]() {
+                    TRACE_SCOPE("readback");
+                    TRACE_GPU_SCOPE("readback");
+                    pipeline.readOutput(readback.data(), nullptr);
+                    pipeline.readOutput(nullptr, readback.data());
+                };
+
+                for (float div : opt.divergences) {
+                    StereoParams params;
+                    params.divergence = div;
+                    pipeline.setParams(params);
+                    if (pipeline.width() != w || pipeline.height() != h)
+                        pipeline.allocateTargets(w, h);
+                    pipeline.setSource(colorTex, depthTex);
+
+                    std::vector<double> samples[STAGE_COUNT], totals, walls;
+                    for (int it = 0; it < opt.warmup + opt.iters; ++it) {
+                        TRACE_SCOPE("iteration");
+                        pipeline.resetTargets();
+
+                        auto t0 = std::chrono::steady_clock::now();
+                        glQueryCounter(queries[0], GL_TIMESTAMP);
+                        upload();
+                        glQueryCounter(queries[1], GL_TIMESTAMP);
+                        pipeline.warp();
+                        glQueryCounter(queries[2], GL_TIMESTAMP);
+                        pipeline.fill();
+                        glQueryCounter(queries[3], GL_TIMESTAMP);
+                        readEyes();
+                        glQueryCounter(queries[4], GL_TIMESTAMP);
+                        glFinish();
+                        auto t1 = std::chrono::steady_clock::now();
+
+                        GLuint64 ts[STAGE_COUNT + 1];
+                        for (int q = 0; q <= STAGE_COUNT; ++q)
+                            glGetQueryObjectui64v(queries[q], GL_QUERY_RESULT, &ts[q]);
+                        if (it < opt.warmup) continue;
+
+                        for (int s = 0; s < STAGE_COUNT; ++s)
+                            samples[s].push_back((ts[s + 1] - ts[s]) / 1e6);
+                        totals.push_back((ts[STAGE_COUNT] - ts[0]) / 1e6);
+                        walls.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+                    }
+
+                    CaseResult r = base;
+                    r.divergence = div;
+                    for (int s = 0; s < STAGE_COUNT; ++s)
+                        r.stages[s] = computeStats(samples[s]);
+                    r.total = computeStats(totals);
+                    r.wall = computeStats(walls);
+                    results.push_back(r);
+
+                    std::cout << r.variant << " " << r.scene << " " << res.name << " div " << div
+                              << ": total median " << r.total.median << " ms, p99 " << r.total.p99 << " ms, "
+                              << r.total.median / (w * double(h) / 1e6) << " ms/MP"
+                              << std::endl;
+                }
+
+                glDeleteTextures(1, &colorTex);
+                if (depthTex) glDeleteTextures(1, &depthTex);
+            }
+
+            // K 帧一批：每次迭代上传 K 帧、各 pass 一次 dispatch、读回 2K 只眼，阶段耗时按帧平均
+            if (opt.batch > 0) {
+                CaseResult base;
+                base.variant = "scatter+tile_prefix+batch" + std::to_string(opt.batch);
+                base.scene = sceneName(kind);
+                base.resolution = res.name;
+                base.width = w;
+                base.height = h;
+                base.batch = opt.batch;
+                base.traffic = pixelTraffic(Variant{WarpVariant::Scatter, FillVariant::TilePrefix});
+                if (w > maxTexSize || h > maxTexSize || !batch.allocate(w, h, opt.batch)) {
+                    for (float div : opt.divergences) {
+                        CaseResult r = base;
+                        r.divergence = div;
+                        r.skipped = "exceeds texture limits";
+                        results.push_back(r);
+                    }
+                    continue;
+                }
+                for (float div : opt.divergences) {
+                    StereoParams params;
+                    params.divergence = div;
+                    for (int f = 0; f < opt.batch; ++f)
+                        batch.setParams(f, params);
+
+                    std::vector<double> samples[STAGE_COUNT], totals, walls;
+                    for (int it = 0; it < opt.warmup + opt.iters; ++it) {
+                        TRACE_SCOPE("iteration");
+                        auto t0 = std::chrono::steady_clock::now();
+                        glQueryCounter(queries[0], GL_TIMESTAMP);
+                        for (int f = 0; f < opt.batch; ++f)
+                            batch.upload(f, scene.rgb.data(), scene.depth.data());
+                        glQueryCounter(queries[1], GL_TIMESTAMP);
+                        batch.warp();
+                        glQueryCounter(queries[2], GL_TIMESTAMP);
+                        batch.fill();
+                        glQueryCounter(queries[3], GL_TIMESTAMP);
+                        for (int f = 0; f < opt.batch; ++f) {
+                            batch.readEye(f, 1, readback.data());
+                            batch.readEye(f, -1, readback.data());
+                        }
+                        glQueryCounter(queries[4], GL_TIMESTAMP);
+                        glFinish();
+                        auto t1 = std::chrono::steady_clock::now();
+
+                        GLuint64 ts[STAGE_COUNT + 1];
+                        for (int q = 0; q <= STAGE_COUNT; ++q)
+                            glGetQueryObjectui64v(queries[q], GL_QUERY_RESULT, &ts[q]);
+                        if (it < opt.warmup) continue;
+
+                        double k = 1e6 * opt.batch;
+                        for (int s = 0; s < STAGE_COUNT; ++s)
+                            samples[s].push_back((ts[s + 1] - ts[s]) / k);
+                        totals.push_back((ts[STAGE_COUNT] - ts[0]) / k);
+                        walls.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count() / opt.batch);
+                    }
+
+                    CaseResult r = base;
+                    r.divergence = div;
+                    for (int s = 0; s < STAGE_COUNT; ++s)
+                        r.stages[s] = computeStats(samples[s]);
+                    r.total = computeStats(totals);
+                    r.wall = computeStats(walls);
+                    results.push_back(r);
+
+                    std::cout << r.variant << " " << r.scene << " " << res.name << " div " << div
+                              << ": total median " << r.total.median << " ms/frame, p99 " << r.total.p99 << " ms, "
+                              << batch.barriersPerBatch() << " barriers/batch" << std::endl;
+                }
+            }
+        }
+    }
+
+    glDeleteQueries(STAGE_COUNT + 1, queries);
+    for (StereoPipeline &pipeline : pipelines)
+        pipeline.release();
+    batch.release();
+
+    bool ok = writeJSON(opt, results);
+    traceShutdown();
+    glfwTerminate();
+    if (ok) std::cout << "Wrote " << opt.out << " (" << results.size() << " cases)" << std::endl;
+    return ok ? 0 : -1;
+}
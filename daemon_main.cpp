@@ -0,0 +1,353 @@
+// stereogen_daemon：常驻转换服务（仅 UNIX）
+// 上下文、着色器和目标纹理只初始化一次，请求经 Unix domain socket 逐行提交，结果写入共享内存
+//
+// 协议：每行一个请求，空格分隔的 key=value，每个请求回一行
+//   ping
+//   convert input=PATH [depth_input=PATH] [layout=separate|sbs|tb|alpha] [depth=r8|rg16|rgb24|a8]
+//   convert shm=NAME width=W height=H [channels=3|4] layout=sbs|tb|alpha [depth=...]
+//   convert shm=NAME depth_shm=NAME width=W height=H [channels=3|4]           （分离：float32 深度）
+//     公共参数：[divergence=2] [convergence=0] [format=rgba8|rgb8|bgra8|nv12|i420] [left=PATH right=PATH]
+//   shutdown
+// 应答：ok key=value ... 或 error <原因>
+// --vram-budget MB：整幅显存规划超出预算的请求被拒绝（daemon 不拆条带）；预算内的余量用于在池中保留
+// 其他尺寸的目标纹理，尺寸来回切换时不再重新分配
+// 未指定 left/right 时结果写入新建的共享内存段（左眼在前、右眼在后，行紧密排列），
+// 段名在应答的 shm= 中返回，由客户端映射后负责 shm_unlink；rgba8 以外的格式在 GPU 上打包后读回
+// （nv12 / i420 为 BT.601 有限范围，每眼各平面依次相接）
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "gl_utils.h"
+#include "rgbd_input.h"
+#include "shared_memory.h"
+#include "stereo_pipeline.h"
+#include "stripe_stream.h"
+#include "trace.h"
+
+static std::atomic<bool> gStop{false};
+
+static void onSignal(int) {
+    gStop = true;
+}
+
+struct Request {
+    std::string command;
+    std::map<std::string, std::string> args;
+
+    bool has(const char *key) const { return args.count(key) != 0; }
+    std::string get(const char *key, const std::string &def = "") const {
+        auto it = args.find(key);
+        return it == args.end() ? def : it->second;
+    }
+    int getInt(const char *key, int def) const { return has(key) ? std::atoi(get(key).c_str()) : def; }
+    float getFloat(const char *key, float def) const { return has(key) ? std::strtof(get(key).c_str(), nullptr) : def; }
+};
+
+static Request parseRequest(const std::string &line) {
+    Request req;
+    std::istringstream in(line);
+    in >> req.command;
+    std::string token;
+    while (in >> token) {
+        size_t eq = token.find('=');
+        if (eq == std::string::npos) {
+            req.args[token] = "";
+        } else {
+            req.args[token.substr(0, eq)] = token.substr(eq + 1);
+        }
+    }
+    return req;
+}
+
+class StereoDaemon {
+public:
+    bool init(const std::string &shaderDir, size_t budgetBytes) {
+        budgetBytes_ = budgetBytes;
+        // 有显存预算时两眼共用竞争键 / edge：两眼串行，每个尺寸省一份
+        pipeline_.setInterleaveEyes(budgetBytes == 0);
+        return pipeline_.loadPrograms(WarpVariant::Scatter, FillVariant::TilePrefix, shaderDir);
+    }
+
+    void release() { pipeline_.release(); }
+
+    // 处理一行请求，返回应答（不含换行）；shutdown 时置 stop
+    std::string handle(const std::string &line, bool &stop) {
+        Request req = parseRequest(line);
+        if (req.command == "ping") return "ok pong";
+        if (req.command == "shutdown") {
+            stop = true;
+            return "ok bye";
+        }
+        if (req.command == "convert") return convert(req);
+        return "error unknown command '" + req.command + "'";
+    }
+
+private:
+    std::string loadInput(const Request &req, RGBDInput &input) {
+        InputLayout layout = InputLayout::Separate;
+        DepthEncoding encoding = DepthEncoding::R8;
+        if (req.has("layout") && !parseInputLayout(req.get("layout"), layout)) return "unknown layout";
+        if (layout == InputLayout::ColorAlpha) encoding = DepthEncoding::A8;
+        if (req.has("depth") && !parseDepthEncoding(req.get("depth"), encoding)) return "unknown depth encoding";
+
+        if (req.has("input")) {
+            std::string path = req.get("input");
+            bool ok = layout == InputLayout::Separate
+                          ? loadSeparateRGBD(path.c_str(), req.get("depth_input").c_str(), input)
+                          : loadPackedRGBD(path.c_str(), layout, encoding, input);
+            return ok ? "" : "cannot load " + path;
+        }
+
+        if (req.has("shm")) {
+            int w = req.getInt("width", 0), h = req.getInt("height", 0);
+            int channels = req.getInt("channels", 3);
+            if (w <= 0 || h <= 0 || (channels != 3 && channels != 4)) return "bad width/height/channels";
+
+            SharedMemory color;
+            if (!color.open(req.get("shm"), size_t(w) * h * channels)) return "cannot map shm " + req.get("shm");
+            if (layout != InputLayout::Separate) {
+                bool ok = createPackedRGBD(color.data(), w, h, channels, layout, encoding, input);
+                return ok ? "" : "bad packed input";
+            }
+            SharedMemory depth;
+            if (!depth.open(req.get("depth_shm"), size_t(w) * h * sizeof(float)))
+                return "cannot map depth_shm " + req.get("depth_shm");
+            bool ok = createSeparateRGBD(color.data(), channels, reinterpret_cast<const float *>(depth.data()), w,
+                                         h, input);
+            return ok ? "" : "bad separate input";
+        }
+        return "missing input= or shm=";
+    }
+
+    std::string convert(const Request &req) {
+        auto t0 = std::chrono::steady_clock::now();
+        TRACE_SCOPE("convert");
+
+        RGBDInput input;
+        std::string err = loadInput(req, input);
+        if (!err.empty()) {
+            input.release();
+            return "error " + err;
+        }
+        const int w = input.width, h = input.height;
+
+        StereoParams params;
+        params.divergence = req.getFloat("divergence", 2.0f);
+        params.convergence = req.getFloat("convergence", 0.0f);
+        pipeline_.setParams(params);
+
+        // 写入共享内存时按请求的格式打包；写 PNG 时直接读回纹理
+        static const struct {
+            const char *name;
+            OutputFormat format;
+        } kFormats[] = {{"rgba8", OutputFormat::RGBA},
+                        {"rgb8", OutputFormat::RGB},
+                        {"bgra8", OutputFormat::BGRA},
+                        {"nv12", OutputFormat::NV12},
+                        {"i420", OutputFormat::I420}};
+        bool toFiles = req.has("left") && req.has("right");
+        std::string format = req.get("format", "rgba8");
+        OutputFormat outFormat = OutputFormat::RGBA;
+        if (!toFiles) {
+            auto it = std::find_if(std::begin(kFormats), std::end(kFormats),
+                                   [&](const auto &f) { return format == f.name; });
+            if (it == std::end(kFormats)) {
+                input.release();
+                return "error unknown format " + format;
+            }
+            outFormat = it->format;
+        }
+        if (!pipeline_.setOutputFormat(outFormat)) {
+            input.release();
+            return "error cannot compile the output packing shader";
+        }
+
+        VramPlan plan = planVram(w, h, budgetBytes_, false, ColorResolve::Eager, WarpVariant::Scatter, budgetBytes_ == 0);
+        if (!plan.fits) {
+            input.release();
+            std::ostringstream err;
+            err << "exceeds VRAM budget (" << (plan.frameBytes() >> 20) << " MiB > " << (budgetBytes_ >> 20)
+                << " MiB)";
+            return "error " + err.str();
+        }
+
+        // 目标纹理按尺寸复用，只在尺寸变化时重新分配（旧尺寸在预算余量内留在池中）
+        if (pipeline_.width() != w || pipeline_.height() != h) {
+            if (budgetBytes_ > 0) pipeline_.setPoolLimit(budgetBytes_ - plan.frameBytes());
+            pipeline_.allocateTargets(w, h);
+        } else {
+            pipeline_.resetTargets();
+        }
+        if (!pipeline_.setSource(input)) {
+            input.release();
+            return "error input layout not supported by the warp variant";
+        }
+
+        auto tc = std::chrono::steady_clock::now();
+        pipeline_.warp();
+        pipeline_.fill();
+        glFinish();
+        double computeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tc).count();
+        input.release();
+
+        std::ostringstream reply;
+        reply << "ok width=" << w << " height=" << h;
+
+        if (toFiles) {
+            saveTexturePNG(pipeline_.left.color, w, h, req.get("left").c_str());
+            saveTexturePNG(pipeline_.right.color, w, h, req.get("right").c_str());
+            reply << " left=" << req.get("left") << " right=" << req.get("right");
+        } else {
+            size_t eyeBytes = outputBytes(outFormat, w, h);
+
+            std::string name = "/stereogen-" + std::to_string(getpid()) + "-" + std::to_string(++seq_);
+            SharedMemory out;
+            if (!out.create(name, eyeBytes * 2)) return "error cannot create result shm";
+
+            // 直接读回到映射内存，不经过中间缓冲
+            TRACE_SCOPE("readback");
+            pipeline_.readOutput(out.data(), out.data() + eyeBytes);
+
+            reply << " shm=" << name << " format=" << format << " size=" << eyeBytes * 2
+                  << " left_offset=0 right_offset=" << eyeBytes;
+        }
+
+        double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        reply << " compute_ms=" << computeMs << " total_ms=" << totalMs;
+        return reply.str();
+    }
+
+    StereoPipeline pipeline_;
+    size_t budgetBytes_ = 0; // 0 表示不限
+    uint64_t seq_ = 0;
+};
+
+static bool writeAll(int fd, const std::string &s) {
+    size_t off = 0;
+    while (off < s.size()) {
+        ssize_t n = write(fd, s.data() + off, s.size() - off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        off += size_t(n);
+    }
+    return true;
+}
+
+// 逐行读取请求直到对端关闭；返回 false 表示收到 shutdown
+static bool serveClient(int fd, StereoDaemon &daemon) {
+    std::string buffer;
+    char chunk[4096];
+    while (!gStop) {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        buffer.append(chunk, size_t(n));
+
+        size_t nl;
+        while ((nl = buffer.find('\n')) != std::string::npos) {
+            std::string line = buffer.substr(0, nl);
+            buffer.erase(0, nl + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+
+            bool stop = false;
+            std::string reply = daemon.handle(line, stop);
+            std::cout << "> " << line << "\n< " << reply << std::endl;
+            if (!writeAll(fd, reply + "\n")) return true;
+            if (stop) return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    std::string socketPath = "/tmp/stereogen.sock";
+    std::string shaderDir;
+    std::string tracePath;
+    size_t budgetBytes = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "--shaders" && i + 1 < argc) {
+            shaderDir = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--vram-budget" && i + 1 < argc) {
+            budgetBytes = size_t(std::max(0, std::atoi(argv[++i]))) << 20;
+        } else {
+            std::cerr << "Usage: stereogen_daemon [--socket PATH] [--shaders DIR] [--trace FILE] [--vram-budget MB]"
+                      << std::endl;
+            return -1;
+        }
+    }
+
+    traceInit(tracePath);
+    if (!createOffscreenContext()) {
+        return -1;
+    }
+    StereoDaemon daemon;
+    if (!daemon.init(shaderDir, budgetBytes)) {
+        std::cerr << "Shader compilation failed" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (server < 0 || socketPath.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Cannot create socket " << socketPath << std::endl;
+        return -1;
+    }
+    std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socketPath.c_str());
+    if (bind(server, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(server, 8) != 0) {
+        std::cerr << "Cannot listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        close(server);
+        return -1;
+    }
+
+    // 不设 SA_RESTART：信号打断 accept/read 后检查 gStop 退出
+    struct sigaction sa{};
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    std::cout << "Listening on " << socketPath << std::endl;
+    while (!gStop) {
+        int client = accept(server, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "accept failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        bool keepRunning = serveClient(client, daemon);
+        close(client);
+        if (!keepRunning) break;
+    }
+
+    close(server);
+    unlink(socketPath.c_str());
+    daemon.release();
+    traceShutdown();
+    glfwTerminate();
+    std::cout << "Daemon stopped" << std::endl;
+    return 0;
+}
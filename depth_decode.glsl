@@ -0,0 +1,35 @@
+// 深度解码片段：不单独编译，宿主把它插在读深度的着色器（warp / warp_splat / warp_gather / warp_row / warp_mesh.vert /
+// gather_color / disparity / depth_range）的 #define 之后。各着色器不再各自声明 srcDepth / depthOffset / depthEncoding，
+// 也不再各自实现解码与归一化，变体之间的逐位一致只依赖这一份
+#ifdef BATCH
+layout(binding = 1) uniform sampler2DArray srcDepth;
+#define DEPTH_TEXEL(p) ivec3(p, int(gl_WorkGroupID.z) >> 1) // 目标层 2f / 2f+1 取第 f 帧
+#else
+layout(binding = 1) uniform sampler2D srcDepth;   // 打包 / SBS 输入时与颜色为同一纹理
+#define DEPTH_TEXEL(p) (p)
+#endif
+
+uniform ivec2 depthOffset;    // 深度在 srcDepth 中的起点：SBS 为 (orgWidth,0)，上下为 (0,orgHeight)
+uniform int   depthEncoding;  // 0 = R32F，1 = R8，2 = RG16，3 = RGB24，4 = A8
+
+// 8 位编码先还原为字节再组合：与 CPU 解码逐位一致，24 位时也没有 dot 的舍入误差
+float decodeDepth(ivec2 p){
+    vec4 t = texelFetch(srcDepth, DEPTH_TEXEL(p + depthOffset), 0);
+    if(depthEncoding == 0) return t.r;
+    uvec4 b = uvec4(round(t * 255.0));
+    if(depthEncoding == 2) return float((b.r << 8) | b.g) / 65535.0;
+    if(depthEncoding == 3) return float((b.r << 16) | (b.g << 8) | b.b) / 16777215.0;
+    return float(depthEncoding == 4 ? b.a : b.r) / 255.0;
+}
+
+#ifdef DEPTH_NORM
+// 深度归一化（宿主注入 DEPTH_NORM）：depth_range.comp 在 GPU 上统计深度范围后写出参数，不经 CPU 读回；
+// 有效深度映射到 [1/64, 1]（米制等任意范围的 EXR 不再把视差顶满），深度 <= 0（无数据）或非有限值仍为 0
+layout(std140, binding = 0) uniform DepthNorm { float depthLo; float depthScale; };
+float loadDepth(ivec2 p){
+    float z = decodeDepth(p);
+    return z > 0.0 && !isinf(z) ? clamp((z - depthLo) * depthScale, 0.0, 1.0) : 0.0;
+}
+#else
+float loadDepth(ivec2 p){ return decodeDepth(p); }
+#endif
@@ -0,0 +1,240 @@
+#include "frame_batch.h"
+#include "gl_utils.h"
+#include "texture_pool.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+GLuint createArrayTexture(GLenum format, int width, int height, int layers) {
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, tex);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, format, width, height, layers);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return tex;
+}
+
+} // namespace
+
+bool FrameBatch::loadPrograms(const std::string &shaderDir) {
+    auto path = [&](const char *name) { return shaderDir.empty() ? std::string(name) : shaderDir + "/" + name; };
+    const std::string defines = "#define BATCH\n";
+    warpProg_ = createComputeProgram(path("warp.comp").c_str(), defines + StereoPipeline::depthDecodeSource(shaderDir));
+    resolveProg_ = createComputeProgram(path("warp_resolve.comp").c_str(), defines);
+    tileProg_ = createComputeProgram(path("fill_tile.comp").c_str(), defines);
+    prefixProg_ = createComputeProgram(path("fill_prefix.comp").c_str(), defines);
+    if (!readFbo_) glGenFramebuffers(1, &readFbo_);
+    return warpProg_ && resolveProg_ && tileProg_ && prefixProg_;
+}
+
+int FrameBatch::maxFrames() {
+    GLint layers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &layers);
+    return layers / 2;
+}
+
+bool FrameBatch::allocate(int width, int height, int frames) {
+    if (frames < 1 || frames > maxFrames()) {
+        std::cerr << "Batch of " << frames << " frames exceeds array texture layers (max " << maxFrames()
+                  << " frames)" << std::endl;
+        return false;
+    }
+    releaseTargets();
+    width_ = width;
+    height_ = height;
+    frames_ = frames;
+    numTile_ = (width + TILE_W - 1) / TILE_W;
+    idxBits_ = StereoPipeline::keyIndexBits(width);
+    params_.assign(size_t(frames), StereoParams());
+    paramsDirty_ = true;
+
+    int layers = frames * 2;
+    srcColor_ = createArrayTexture(GL_RGB8, width, height, frames);
+    srcDepth_ = createArrayTexture(GL_R32F, width, height, frames);
+    color_ = createArrayTexture(GL_RGBA8, width, height, layers);
+    index_ = createArrayTexture(GL_R32UI, width, height, layers);
+    key_ = createArrayTexture(GL_R32UI, width, height, layers);
+    edge_ = createArrayTexture(GL_RGBA32UI, numTile_ * 2, height, layers); // 每 tile 2 像素
+
+    glGenBuffers(1, &layerBuf_);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, layerBuf_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(LayerParams) * size_t(layers)), nullptr,
+                 GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return true;
+}
+
+size_t FrameBatch::batchBytes(int width, int height, int frames) {
+    int numTile = (width + TILE_W - 1) / TILE_W;
+    size_t layerBytes = TexturePool::textureBytes(GL_RGBA8, width, height) +
+                        2 * TexturePool::textureBytes(GL_R32UI, width, height) +
+                        TexturePool::textureBytes(GL_RGBA32UI, numTile * 2, height);
+    size_t sourceBytes = TexturePool::textureBytes(GL_RGB8, width, height) +
+                         TexturePool::textureBytes(GL_R32F, width, height);
+    return size_t(frames) * (2 * layerBytes + sourceBytes);
+}
+
+void FrameBatch::upload(int frame, const uint8_t *rgb, const float *depth) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, srcColor_);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, frame, width_, height_, 1, GL_RGB, GL_UNSIGNED_BYTE, rgb);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, srcDepth_);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, frame, width_, height_, 1, GL_RED, GL_FLOAT, depth);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void FrameBatch::setParams(int frame, const StereoParams &params) {
+    params_[size_t(frame)] = params;
+    paramsDirty_ = true;
+}
+
+void FrameBatch::warp() {
+    // 每层参数取自 StereoPipeline 的同一组算式
+    int pad = 0;
+    for (const StereoParams &p : params_) pad = std::max(pad, StereoPipeline::padSizeOf(p, width_));
+    if (paramsDirty_) {
+        std::vector<LayerParams> layers(size_t(frames_) * 2);
+        for (int f = 0; f < frames_; ++f) {
+            for (int e = 0; e < 2; ++e) {
+                const StereoParams &p = params_[size_t(f)];
+                float shiftScale = StereoPipeline::shiftScaleOf(p, width_, e == 0 ? 1 : -1);
+                LayerParams &l = layers[size_t(f * 2 + e)];
+                l.shiftScale = shiftScale;
+                l.shiftBias = -p.convergence * shiftScale;
+                l.maxHole = StereoPipeline::maxHoleOf(shiftScale);
+                l.padSize = StereoPipeline::padSizeOf(p, width_);
+            }
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, layerBuf_);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(sizeof(LayerParams) * layers.size()), layers.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        paramsDirty_ = false;
+    }
+
+    int paddedW = width_ + pad * 2;
+    GLuint layers = GLuint(frames_ * 2);
+    ResourceUse srcColor{texResource(srcColor_, "src color"), Access::Sampled};
+    ResourceUse srcDepth{texResource(srcDepth_, "src depth"), Access::Sampled};
+    FrameResource key = texResource(key_, "key");
+    ResourceUse color{texResource(color_, "color"), Access::ImageWrite};
+    ResourceUse index{texResource(index_, "index"), Access::ImageWrite};
+
+    warpGraph_.reset("batch warp");
+    // 分层挂接：一次清零全部层的竞争键
+    warpGraph_.addPass("clear key", {{key, Access::RenderTarget}}, [=] {
+        const GLuint zero[4] = {0u, 0u, 0u, 0u};
+        glBindFramebuffer(GL_FRAMEBUFFER, readFbo_);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, key_, 0);
+        glDrawBuffer(GL_COLOR_ATTACHMENT0);
+        glClearBufferuiv(GL_COLOR, 0, zero);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    });
+    warpGraph_.addPass("warp", {srcDepth, {key, Access::ImageReadWrite}}, [=] {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, srcDepth_);
+        glUseProgram(warpProg_);
+        glBindImageTexture(3, key_, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32UI);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, layerBuf_);
+        glUniform1i(glGetUniformLocation(warpProg_, "srcDepth"), 1);
+        glUniform1i(glGetUniformLocation(warpProg_, "orgWidth"), width_);
+        glUniform1i(glGetUniformLocation(warpProg_, "orgHeight"), height_);
+        glUniform1i(glGetUniformLocation(warpProg_, "idxBits"), idxBits_);
+        glUniform2i(glGetUniformLocation(warpProg_, "depthOffset"), 0, 0);
+        glUniform1i(glGetUniformLocation(warpProg_, "depthEncoding"), int(DepthEncoding::Float));
+        glUniform1i(glGetUniformLocation(warpProg_, "originX"), 0);
+        glDispatchCompute((paddedW + 15) / 16, (height_ + 15) / 16, layers);
+    });
+    warpGraph_.addPass("resolve", {srcColor, {key, Access::ImageRead}, color, index}, [=] {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, srcColor_);
+        glUseProgram(resolveProg_);
+        glBindImageTexture(2, color_, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        glBindImageTexture(3, key_, 0, GL_TRUE, 0, GL_READ_ONLY, GL_R32UI);
+        glBindImageTexture(4, index_, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R32UI);
+        glUniform1i(glGetUniformLocation(resolveProg_, "srcColor"), 0);
+        glUniform1i(glGetUniformLocation(resolveProg_, "orgWidth"), width_);
+        glUniform1i(glGetUniformLocation(resolveProg_, "orgHeight"), height_);
+        glUniform1i(glGetUniformLocation(resolveProg_, "idxBits"), idxBits_);
+        glUniform1i(glGetUniformLocation(resolveProg_, "indexOnly"), 0);
+        glDispatchCompute((width_ + 15) / 16, (height_ + 15) / 16, layers);
+    });
+    warpGraph_.addOutput(color.resource, Access::ImageReadWrite);
+    warpGraph_.addOutput(index.resource, Access::ImageReadWrite);
+    warpGraph_.execute();
+}
+
+void FrameBatch::fill() {
+    GLuint layers = GLuint(frames_ * 2);
+    ResourceUse color{texResource(color_, "color"), Access::ImageReadWrite};
+    ResourceUse index{texResource(index_, "index"), Access::ImageReadWrite};
+    FrameResource edge = texResource(edge_, "edge");
+
+    fillGraph_.reset("batch fill");
+    // Pass-B-1 : tile 内填充，眼别与传播上限按层取
+    fillGraph_.addPass("fill tile", {color, index, {edge, Access::ImageWrite}}, [=] {
+        glUseProgram(tileProg_);
+        glBindImageTexture(2, color_, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA8);
+        glBindImageTexture(4, index_, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32UI);
+        glBindImageTexture(5, edge_, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA32UI);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, layerBuf_);
+        glUniform1i(glGetUniformLocation(tileProg_, "orgWidth"), width_);
+        glUniform1i(glGetUniformLocation(tileProg_, "orgHeight"), height_);
+        glUniform1i(glGetUniformLocation(tileProg_, "indexOnly"), 0);
+        glDispatchCompute(numTile_, height_, layers);
+    });
+    // Pass-B-2 : tile 间前缀传播
+    fillGraph_.addPass("fill prefix", {color, index, {edge, Access::ImageRead}}, [=] {
+        glUseProgram(prefixProg_);
+        glBindImageTexture(2, color_, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA8);
+        glBindImageTexture(4, index_, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32UI);
+        glBindImageTexture(5, edge_, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA32UI);
+        glUniform1i(glGetUniformLocation(prefixProg_, "orgWidth"), width_);
+        glUniform1i(glGetUniformLocation(prefixProg_, "orgHeight"), height_);
+        glUniform1i(glGetUniformLocation(prefixProg_, "numTile"), numTile_);
+        glUniform1i(glGetUniformLocation(prefixProg_, "indexOnly"), 0);
+        glUniform1i(glGetUniformLocation(prefixProg_, "tileBegin"), 0);
+        glUniform1i(glGetUniformLocation(prefixProg_, "tileEnd"), numTile_);
+        glUniform1i(glGetUniformLocation(prefixProg_, "useCarry"), 0);
+        glDispatchCompute(1, height_, layers);
+    });
+    // 之后：readEye 经 FBO 读回颜色，下一批的 warp 重写颜色 / 索引
+    fillGraph_.addOutput(color.resource, Access::FramebufferRead);
+    fillGraph_.addOutput(color.resource, Access::ImageWrite);
+    fillGraph_.addOutput(index.resource, Access::ImageWrite);
+    fillGraph_.execute();
+}
+
+void FrameBatch::readEye(int frame, int eyeSign, uint8_t *rgb) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo_);
+    glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, color_, 0, frame * 2 + (eyeSign > 0 ? 0 : 1));
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width_, height_, GL_RGB, GL_UNSIGNED_BYTE, rgb);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+void FrameBatch::releaseTargets() {
+    GLuint textures[] = {srcColor_, srcDepth_, color_, index_, key_, edge_};
+    for (GLuint tex : textures)
+        if (tex) glDeleteTextures(1, &tex);
+    srcColor_ = srcDepth_ = color_ = index_ = key_ = edge_ = 0;
+    if (layerBuf_) glDeleteBuffers(1, &layerBuf_);
+    layerBuf_ = 0;
+}
+
+void FrameBatch::release() {
+    releaseTargets();
+    glDeleteProgram(warpProg_);
+    glDeleteProgram(resolveProg_);
+    glDeleteProgram(tileProg_);
+    glDeleteProgram(prefixProg_);
+    warpProg_ = resolveProg_ = tileProg_ = prefixProg_ = 0;
+    if (readFbo_) glDeleteFramebuffers(1, &readFbo_);
+    readFbo_ = 0;
+}
@@ -0,0 +1,70 @@
+#pragma once
+// 多帧批处理：小分辨率下每帧的 dispatch 只有几十个工作组，固定开销（pass 提交、barrier、uniform）占主导。
+// K 帧同尺寸输入作为二维数组纹理的 K 层一起上传，warp / fill 的每个 pass 只 dispatch 一次，
+// 工作组 z 为目标层（2f 为第 f 帧左眼、2f+1 为右眼），每层的位移 / 传播上限放在 SSBO 里，
+// 各帧可以有不同的立体参数。着色器与单帧共用（宿主注入 #define BATCH），
+// 每层结果与 StereoPipeline（Scatter + TilePrefix，即时取色）逐帧处理逐位一致
+//
+// 补边宽度按层取自 SSBO（与逐帧相同，投射位置的浮点舍入与补边有关），warp 按批内最宽的补边 dispatch
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "frame_graph.h"
+#include "stereo_pipeline.h"
+
+class FrameBatch {
+public:
+    static const int TILE_W = StereoPipeline::TILE_W;
+
+    // 编译 warp / warp_resolve / fill_tile / fill_prefix 的批处理特化，shaderDir 为空时从工作目录读取
+    bool loadPrograms(const std::string &shaderDir = "");
+    // 一批最多的帧数（数组纹理层数上限的一半），需要当前 GL 上下文
+    static int maxFrames();
+    // 为 frames 帧 width x height 的输入分配源 / 目标数组纹理；超出层数上限时返回 false
+    bool allocate(int width, int height, int frames);
+    // 目标与源数组纹理的显存
+    static size_t batchBytes(int width, int height, int frames);
+    // 第 frame 帧的输入：rgb 为 RGB8、depth 为 float，行紧密排列
+    void upload(int frame, const uint8_t *rgb, const float *depth);
+    void setParams(int frame, const StereoParams &params);
+    // 全部 K 帧的 warp / fill，各一张帧图（每个 pass 一次 dispatch）
+    void warp();
+    void fill();
+    void run() {
+        warp();
+        fill();
+    }
+    // 读回第 frame 帧一只眼（左眼 +1、右眼 -1）的颜色，RGB8 行紧密排列
+    void readEye(int frame, int eyeSign, uint8_t *rgb);
+    int barriersPerBatch() const { return warpGraph_.barrierCount() + fillGraph_.barrierCount(); }
+    void release();
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int frames() const { return frames_; }
+
+private:
+    // 与 warp.comp 等的 BatchLayer 一致（std430）
+    struct LayerParams {
+        float shiftScale;
+        float shiftBias;
+        int32_t maxHole;
+        int32_t padSize;
+    };
+    void releaseTargets();
+
+    GLuint warpProg_ = 0, resolveProg_ = 0, tileProg_ = 0, prefixProg_ = 0;
+    GLuint srcColor_ = 0, srcDepth_ = 0;                 // RGB8 / R32F，K 层
+    GLuint color_ = 0, index_ = 0, key_ = 0, edge_ = 0;  // 2K 层
+    GLuint layerBuf_ = 0;                                // 2K 个 LayerParams
+    GLuint readFbo_ = 0;
+    std::vector<StereoParams> params_;
+    bool paramsDirty_ = true;
+    FrameGraph warpGraph_, fillGraph_;
+    int width_ = 0, height_ = 0, frames_ = 0;
+    int numTile_ = 0;
+    int idxBits_ = 8;
+};
@@ -0,0 +1,229 @@
+#include "frame_graph.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+bool writes(Access access) {
+    return access == Access::ImageWrite || access == Access::ImageReadWrite || access == Access::StorageAtomic ||
+           access == Access::StorageReadWrite || access == Access::RenderTarget;
+}
+
+// 着色器经 image / SSBO 的访问不经过 GL 的隐式同步
+bool incoherent(Access access) {
+    return access == Access::ImageRead || access == Access::ImageWrite || access == Access::ImageReadWrite ||
+           access == Access::StorageAtomic || access == Access::StorageReadWrite;
+}
+
+bool conflicts(Access a, Access b) {
+    if (a == Access::StorageAtomic && b == Access::StorageAtomic) return false;
+    return writes(a) || writes(b);
+}
+
+bool sameResource(const FrameResource &a, const FrameResource &b) {
+    return a.name == b.name && a.buffer == b.buffer;
+}
+
+const char *accessName(Access access) {
+    switch (access) {
+    case Access::ImageRead: return "image read";
+    case Access::ImageWrite: return "image write";
+    case Access::ImageReadWrite: return "image rw";
+    case Access::Sampled: return "sampled";
+    case Access::Uniform: return "uniform";
+    case Access::StorageAtomic: return "ssbo atomic";
+    case Access::StorageReadWrite: return "ssbo rw";
+    case Access::RenderTarget: return "render target";
+    case Access::Readback: return "readback";
+    case Access::FramebufferRead: return "framebuffer read";
+    }
+    return "?";
+}
+
+void dumpUses(std::ostream &os, const std::vector<ResourceUse> &uses) {
+    bool first = true;
+    for (const ResourceUse &use : uses) {
+        if (!use.resource.name) continue;
+        os << (first ? "" : ", ") << use.resource.label << " (" << accessName(use.access) << ")";
+        first = false;
+    }
+}
+
+} // namespace
+
+GLbitfield barrierBitFor(Access access, bool buffer) {
+    switch (access) {
+    case Access::ImageRead:
+    case Access::ImageWrite:
+    case Access::ImageReadWrite: return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+    case Access::Sampled: return GL_TEXTURE_FETCH_BARRIER_BIT;
+    case Access::Uniform: return GL_UNIFORM_BARRIER_BIT;
+    case Access::StorageAtomic:
+    case Access::StorageReadWrite: return GL_SHADER_STORAGE_BARRIER_BIT;
+    case Access::RenderTarget:
+    case Access::FramebufferRead: return GL_FRAMEBUFFER_BARRIER_BIT;
+    case Access::Readback: return buffer ? GL_BUFFER_UPDATE_BARRIER_BIT : GL_TEXTURE_UPDATE_BARRIER_BIT;
+    }
+    return GL_ALL_BARRIER_BITS;
+}
+
+std::string barrierBitsName(GLbitfield bits) {
+    static const struct {
+        GLbitfield bit;
+        const char *name;
+    } names[] = {
+        {GL_SHADER_IMAGE_ACCESS_BARRIER_BIT, "SHADER_IMAGE_ACCESS"},
+        {GL_TEXTURE_FETCH_BARRIER_BIT, "TEXTURE_FETCH"},
+        {GL_UNIFORM_BARRIER_BIT, "UNIFORM"},
+        {GL_SHADER_STORAGE_BARRIER_BIT, "SHADER_STORAGE"},
+        {GL_FRAMEBUFFER_BARRIER_BIT, "FRAMEBUFFER"},
+        {GL_TEXTURE_UPDATE_BARRIER_BIT, "TEXTURE_UPDATE"},
+        {GL_BUFFER_UPDATE_BARRIER_BIT, "BUFFER_UPDATE"},
+    };
+    std::string s;
+    for (const auto &n : names) {
+        if (!(bits & n.bit)) continue;
+        if (!s.empty()) s += " | ";
+        s += n.name;
+        bits &= ~n.bit;
+    }
+    if (bits) s += s.empty() ? "OTHER" : " | OTHER";
+    return s.empty() ? "NONE" : s;
+}
+
+void FrameGraph::reset(const char *name) {
+    name_ = name;
+    passes_.clear();
+    outputs_.clear();
+    levels_.clear();
+    states_.clear();
+    finalBarrier_ = 0;
+    barrierCount_ = 0;
+}
+
+void FrameGraph::addPass(const char *name, std::vector<ResourceUse> uses, std::function<void()> run) {
+    uses.erase(std::remove_if(uses.begin(), uses.end(), [](const ResourceUse &u) { return u.resource.name == 0; }),
+               uses.end());
+    passes_.push_back(Pass{name, std::move(uses), std::move(run)});
+}
+
+void FrameGraph::addOutput(const FrameResource &resource, Access access) {
+    if (resource.name) outputs_.push_back(ResourceUse{resource, access});
+}
+
+FrameGraph::State &FrameGraph::stateFor(const FrameResource &resource) {
+    for (State &st : states_)
+        if (sameResource(st.resource, resource)) return st;
+    states_.push_back(State());
+    states_.back().resource = resource;
+    return states_.back();
+}
+
+GLbitfield FrameGraph::bitsNeeded(const ResourceUse &use) {
+    State &st = stateFor(use.resource);
+    GLbitfield bit = barrierBitFor(use.access, use.resource.buffer);
+    GLbitfield bits = 0;
+    // 写后读 / 写后写：上次非一致写对这种访问方式尚不可见（原子加之间除外）
+    if (st.dirty && !(st.visible & bit) && !(st.atomicOnly && use.access == Access::StorageAtomic)) bits |= bit;
+    // 读后写：之前的非一致读可能还没执行完
+    if (writes(use.access) && st.pendingRead) bits |= bit;
+    return bits;
+}
+
+void FrameGraph::applyBarrier(GLbitfield bits) {
+    if (!bits) return;
+    for (State &st : states_) {
+        if (st.dirty) st.visible |= bits;
+        st.pendingRead = false;
+    }
+}
+
+void FrameGraph::applyUse(const ResourceUse &use) {
+    State &st = stateFor(use.resource);
+    if (writes(use.access)) {
+        if (incoherent(use.access)) {
+            bool atomic = use.access == Access::StorageAtomic;
+            st.atomicOnly = atomic && (!st.dirty || st.atomicOnly);
+            st.dirty = true;
+            st.visible = 0;
+        } else {
+            st.dirty = st.atomicOnly = false;
+            st.visible = 0;
+        }
+    }
+    // 原子加之间可交换，不需要与之后的原子加隔开；之后的普通写由写后写规则隔开
+    if (incoherent(use.access) && use.access != Access::ImageWrite && use.access != Access::StorageAtomic)
+        st.pendingRead = true;
+}
+
+void FrameGraph::schedule() {
+    // 分层：排在所有冲突的前序 pass 之后（保持加入顺序中的依赖方向）
+    int numLevels = 0;
+    for (size_t i = 0; i < passes_.size(); ++i) {
+        Pass &p = passes_[i];
+        p.level = 0;
+        for (size_t j = 0; j < i; ++j) {
+            const Pass &q = passes_[j];
+            bool dependent = false;
+            for (const ResourceUse &a : p.uses)
+                for (const ResourceUse &b : q.uses)
+                    if (sameResource(a.resource, b.resource) && conflicts(a.access, b.access)) dependent = true;
+            if (dependent) p.level = std::max(p.level, q.level + 1);
+        }
+        numLevels = std::max(numLevels, p.level + 1);
+    }
+    levels_.assign(size_t(numLevels), Level());
+    for (size_t i = 0; i < passes_.size(); ++i) levels_[size_t(passes_[i].level)].passes.push_back(int(i));
+
+    // barrier：每层之前合并本层所有访问需要的位，同层 pass 之间不冲突，可以一次发出
+    states_.clear();
+    barrierCount_ = 0;
+    for (Level &level : levels_) {
+        for (int i : level.passes)
+            for (const ResourceUse &use : passes_[size_t(i)].uses) level.barrier |= bitsNeeded(use);
+        applyBarrier(level.barrier);
+        if (level.barrier) ++barrierCount_;
+        for (int i : level.passes)
+            for (const ResourceUse &use : passes_[size_t(i)].uses) applyUse(use);
+    }
+    finalBarrier_ = 0;
+    for (const ResourceUse &use : outputs_) finalBarrier_ |= bitsNeeded(use);
+    applyBarrier(finalBarrier_);
+    if (finalBarrier_) ++barrierCount_;
+}
+
+void FrameGraph::execute() {
+    schedule();
+    for (const Level &level : levels_) {
+        if (level.barrier) glMemoryBarrier(level.barrier);
+        for (int i : level.passes) {
+            const Pass &p = passes_[size_t(i)];
+            TRACE_GPU_SCOPE(p.name);
+            p.run();
+        }
+    }
+    if (finalBarrier_) glMemoryBarrier(finalBarrier_);
+}
+
+void FrameGraph::dump(std::ostream &os) const {
+    os << "frame graph " << name_ << ": " << passes_.size() << " passes, " << levels_.size() << " levels, "
+       << barrierCount_ << " barriers" << std::endl;
+    for (size_t l = 0; l < levels_.size(); ++l) {
+        const Level &level = levels_[l];
+        if (level.barrier) os << "  barrier " << barrierBitsName(level.barrier) << std::endl;
+        os << "  level " << l << std::endl;
+        for (int i : level.passes) {
+            const Pass &p = passes_[size_t(i)];
+            os << "    " << p.name << ": ";
+            dumpUses(os, p.uses);
+            os << std::endl;
+        }
+    }
+    if (finalBarrier_) {
+        os << "  barrier " << barrierBitsName(finalBarrier_) << " before ";
+        dumpUses(os, outputs_);
+        os << std::endl;
+    }
+}
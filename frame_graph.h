@@ -0,0 +1,99 @@
+#pragma once
+// 帧图：每个 pass 声明自己读写的纹理 / 缓冲，执行前按依赖分层调度并推出最少的 glMemoryBarrier
+// 两个 pass 访问同一资源且至少一方写入时存在依赖（SSBO 原子加之间可交换，不算）；
+// 每个 pass 排在它所依赖的 pass 的下一层，同层 pass 互不依赖、按加入顺序连续提交，
+// 因此左右眼各自的 pass 链自动交错，一层只在需要时发一次 barrier
+//
+// barrier 只针对着色器的非一致写（image / SSBO）：写后的资源在被下一种访问方式使用前
+// 需要对应的位（image → SHADER_IMAGE_ACCESS，采样 → TEXTURE_FETCH，uniform 块 → UNIFORM，
+// 读回 → TEXTURE_UPDATE / BUFFER_UPDATE，经 FBO 读取 → FRAMEBUFFER ...），已发过的位不再重复；绘制 / glClearBuffer 写入挂接纹理是一致的，不需要 barrier
+
+#include <glad/glad.h>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+enum class Access {
+    ImageRead,        // imageLoad
+    ImageWrite,       // imageStore
+    ImageReadWrite,   // imageLoad + imageStore / imageAtomic*
+    Sampled,          // texelFetch / texture
+    Uniform,          // uniform 块（UBO）读取
+    StorageAtomic,    // SSBO 原子加（计数 / 累加），彼此可交换
+    StorageReadWrite, // SSBO 普通读写
+    RenderTarget,     // 绘制或 glClearBuffer 写入挂接的纹理
+    Readback,         // glGetTexImage / glGetBufferSubData / glCopyBufferSubData（仅用于 addOutput）
+    FramebufferRead,  // 挂接到 FBO 后 glReadPixels / glBlitFramebuffer 读取（仅用于 addOutput）
+};
+
+// name 为 0 的资源被忽略（可选的统计缓冲等）；label 须为静态字符串，只用于 dump
+struct FrameResource {
+    GLuint name = 0;
+    bool buffer = false;
+    const char *label = "";
+};
+inline FrameResource texResource(GLuint tex, const char *label) { return {tex, false, label}; }
+inline FrameResource bufResource(GLuint buf, const char *label) { return {buf, true, label}; }
+
+struct ResourceUse {
+    FrameResource resource;
+    Access access;
+};
+
+// 访问方式对应的 barrier 位
+GLbitfield barrierBitFor(Access access, bool buffer);
+// barrier 位的可读名字（"SHADER_IMAGE_ACCESS | TEXTURE_UPDATE"）
+std::string barrierBitsName(GLbitfield bits);
+
+class FrameGraph {
+public:
+    // 清空 pass 与资源状态，name 须为静态字符串；图按帧重建
+    void reset(const char *name);
+    // name 须为静态字符串（同时作为 GPU trace 作用域名）；run 只做绑定、uniform 与 dispatch，不发 barrier
+    void addPass(const char *name, std::vector<ResourceUse> uses, std::function<void()> run);
+    // 图执行完之后资源的访问方式（下一个图或调用方读回），末尾按需补一次 barrier
+    void addOutput(const FrameResource &resource, Access access);
+    // 分层、推导 barrier 并按调度执行
+    void execute();
+    // 最近一次 execute 的调度：每层的 pass 与声明的资源、层前的 barrier
+    void dump(std::ostream &os) const;
+
+    int passCount() const { return int(passes_.size()); }
+    int levelCount() const { return int(levels_.size()); }
+    int barrierCount() const { return barrierCount_; }
+
+private:
+    struct Pass {
+        const char *name;
+        std::vector<ResourceUse> uses;
+        std::function<void()> run;
+        int level = 0;
+    };
+    struct Level {
+        GLbitfield barrier = 0; // 本层之前发出
+        std::vector<int> passes;
+    };
+    // 资源的可见性：上次非一致写之后已经发过哪些位，以及之后是否有未隔开的非一致读
+    struct State {
+        FrameResource resource;
+        bool dirty = false;       // 有未被全部位覆盖的非一致写
+        bool atomicOnly = false;  // 写入只来自 SSBO 原子加
+        GLbitfield visible = 0;   // dirty 时已发过的位
+        bool pendingRead = false; // 上次 barrier 之后有非一致读，再写入前须隔开（读后写）
+    };
+
+    void schedule();
+    State &stateFor(const FrameResource &resource);
+    GLbitfield bitsNeeded(const ResourceUse &use);
+    void applyBarrier(GLbitfield bits);
+    void applyUse(const ResourceUse &use);
+
+    const char *name_ = "";
+    std::vector<Pass> passes_;
+    std::vector<ResourceUse> outputs_;
+    std::vector<Level> levels_;
+    std::vector<State> states_;
+    GLbitfield finalBarrier_ = 0;
+    int barrierCount_ = 0;
+};
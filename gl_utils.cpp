@@ -0,0 +1,354 @@
+#include "gl_utils.h"
+#include "trace.h"
+
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+#define TINYEXR_USE_MINIZ 0
+#define TINYEXR_USE_STB_ZLIB 1
+#define TINYEXR_IMPLEMENTATION
+#include <tinyexr.h>
+
+// 着色器编译工具
+GLuint compileShader(GLenum type, const std::string &source) {
+    GLuint shader = glCreateShader(type);
+    const char *src = source.c_str();
+    glShaderSource(shader, 1, &src, nullptr);
+    glCompileShader(shader);
+
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetShaderInfoLog(shader, 512, nullptr, infoLog);
+        std::cerr << "Shader Compilation Failed:" << infoLog << std::endl;
+    }
+
+    return shader;
+}
+
+std::string loadFile(const char *path) {
+    std::ifstream file(path);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    std::string code = ss.str();
+    std::cout << "[DEBUG] Loaded shader " << path << ", length: " << code.size() << std::endl;
+    return code;
+}
+
+GLuint createComputeProgramFromSource(const std::string &code) {
+    GLuint cs = compileShader(GL_COMPUTE_SHADER, code);
+    GLuint prog = glCreateProgram();
+    glAttachShader(prog, cs);
+    glLinkProgram(prog);
+
+    GLint success;
+    glGetProgramiv(prog, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(prog, 512, nullptr, infoLog);
+        std::cerr << "Compute Shader Linking Failed:" << infoLog << std::endl;
+        glDeleteProgram(prog);
+        prog = 0;
+    }
+
+    glDeleteShader(cs);
+    return prog;
+}
+
+GLuint createComputeProgram(const char *path, const std::string &defines) {
+    return createComputeProgramFromSource(injectDefines(loadFile(path), defines));
+}
+
+GLuint createShaderProgram(const char *vertexPath, const char *fragmentPath, const std::string &defines) {
+    GLuint vs = compileShader(GL_VERTEX_SHADER, injectDefines(loadFile(vertexPath), defines));
+    GLuint fs = compileShader(GL_FRAGMENT_SHADER, loadFile(fragmentPath));
+    GLuint prog = glCreateProgram();
+    glAttachShader(prog, vs);
+    glAttachShader(prog, fs);
+    glLinkProgram(prog);
+
+    GLint success;
+    glGetProgramiv(prog, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(prog, 512, nullptr, infoLog);
+        std::cerr << "Shader Linking Failed:" << infoLog << std::endl;
+        glDeleteProgram(prog);
+        prog = 0;
+    }
+
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    return prog;
+}
+
+std::string injectDefines(const std::string &source, const std::string &defines) {
+    if (defines.empty()) return source;
+    // #version 必须是第一条语句；#line 让编译错误的行号仍对应原文件
+    size_t eol = source.compare(0, 8, "#version") == 0 ? source.find('\n') : std::string::npos;
+    if (eol == std::string::npos) return defines + "#line 1\n" + source;
+    return source.substr(0, eol + 1) + defines + "#line 2\n" + source.substr(eol + 1);
+}
+
+std::string portESToDesktop(const std::string &source) {
+    std::istringstream in(source);
+    std::ostringstream out;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 8, "#version") == 0 && line.find(" es") != std::string::npos) {
+            out << "#version 430\n";
+            continue;
+        }
+        // 桌面 GLSL 的 precision 语句不接受 uint
+        if (line.find("precision") != std::string::npos && line.find("uint") != std::string::npos) {
+            out << "\n"; // 保留行号，编译错误信息仍对得上原文件
+            continue;
+        }
+        out << line << "\n";
+    }
+    return out.str();
+}
+
+// 纹理加载和保存工具
+GLuint loadTextureFromPNG(const char *path, int &width, int &height) {
+    int channels;
+    unsigned char *data;
+    {
+        TRACE_SCOPE("decode PNG");
+        data = stbi_load(path, &width, &height, &channels, 3);
+    }
+    if (!data) {
+        std::cerr << "Failed to load image: " << path << std::endl;
+        return 0;
+    }
+
+    GLuint texID = createColorTexture(data, width, height);
+    stbi_image_free(data);
+    return texID;
+}
+
+bool readDepthEXR(const char *path, std::vector<float> &depth, int &width, int &height) {
+    TRACE_SCOPE("decode EXR");
+    EXRVersion exr_version;
+    int ret = ParseEXRVersionFromFile(&exr_version, path);
+    if (ret != 0) {
+        std::cerr << "Invalid EXR file: " << path << std::endl;
+        return false;
+    }
+
+    if (exr_version.multipart) {
+        std::cerr << "Multipart EXR not supported.";
+        return false;
+    }
+
+    EXRHeader exr_header;
+    InitEXRHeader(&exr_header);
+    const char *err = nullptr;
+
+    ret = ParseEXRHeaderFromFile(&exr_header, &exr_version, path, &err);
+    if (ret != 0) {
+        std::cerr << "Parse EXR err: " << (err ? err : "unknown") << std::endl;
+        FreeEXRErrorMessage(err);
+        return false;
+    }
+
+    for (int i = 0; i < exr_header.num_channels; ++i) {
+        if (exr_header.pixel_types[i] == TINYEXR_PIXELTYPE_HALF) {
+            exr_header.requested_pixel_types[i] = TINYEXR_PIXELTYPE_FLOAT;
+        }
+    }
+
+    EXRImage exr_image;
+    InitEXRImage(&exr_image);
+
+    ret = LoadEXRImageFromFile(&exr_image, &exr_header, path, &err);
+    if (ret != 0) {
+        std::cerr << "Load EXR err: " << (err ? err : "unknown") << std::endl;
+        FreeEXRHeader(&exr_header);
+        FreeEXRErrorMessage(err);
+        return false;
+    }
+
+    width = exr_image.width;
+    height = exr_image.height;
+
+    const float *first = reinterpret_cast<const float *>(exr_image.images[0]);
+    depth.assign(first, first + size_t(width) * height);
+
+    FreeEXRImage(&exr_image);
+    FreeEXRHeader(&exr_header);
+    return true;
+}
+
+GLuint loadDepthFromEXR(const char *path, int &width, int &height) {
+    std::vector<float> depth;
+    if (!readDepthEXR(path, depth, width, height)) {
+        return 0;
+    }
+    return createDepthTexture(depth.data(), width, height);
+}
+
+GLuint createColorTexture(const uint8_t *pixels, int width, int height, int channels) {
+    TRACE_SCOPE("upload color");
+    TRACE_GPU_SCOPE("upload color");
+    bool rgba = channels == 4;
+    GLuint texID;
+    glGenTextures(1, &texID);
+    glBindTexture(GL_TEXTURE_2D, texID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // RGB 行宽不一定是 4 的倍数
+    glTexImage2D(GL_TEXTURE_2D, 0, rgba ? GL_RGBA8 : GL_RGB8, width, height, 0, rgba ? GL_RGBA : GL_RGB,
+                 GL_UNSIGNED_BYTE, pixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texID;
+}
+
+GLuint createDepthTexture(const float *depth, int width, int height) {
+    TRACE_SCOPE("upload depth");
+    TRACE_GPU_SCOPE("upload depth");
+    GLuint texID;
+    glGenTextures(1, &texID);
+    glBindTexture(GL_TEXTURE_2D, texID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, depth);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texID;
+}
+
+void saveTexturePNG(GLuint tex, int w, int h, const char *name) {
+    std::vector<unsigned char> buf(w * h * 3);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    {
+        TRACE_SCOPE("readback");
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_UNSIGNED_BYTE, buf.data());
+    }
+    {
+        TRACE_SCOPE("encode PNG");
+        stbi_write_png(name, w, h, 3, buf.data(), w * 3);
+    }
+    std::cout << "Saved: " << name << std::endl;
+}
+
+// 纹理清空
+static GLuint clearFBO() {
+    static GLuint sFBO = 0;
+    if (!sFBO)
+        glGenFramebuffers(1, &sFBO);
+    return sFBO;
+}
+
+void clearTextureRGBA8(GLuint tex, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    const GLfloat v[4] = {r / 255.f, g / 255.f, b / 255.f, a / 255.f};
+    glBindFramebuffer(GL_FRAMEBUFFER, clearFBO());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glClearBufferfv(GL_COLOR, 0, v);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void clearTextureR32UI(GLuint tex, uint32_t value) {
+    const GLuint v[4] = {value, 0u, 0u, 0u};
+    glBindFramebuffer(GL_FRAMEBUFFER, clearFBO());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glClearBufferuiv(GL_COLOR, 0, v);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void clearTextureRGBA32UI(GLuint tex, uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+    const GLuint v[4] = {r, g, b, a};
+    glBindFramebuffer(GL_FRAMEBUFFER, clearFBO());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glClearBufferuiv(GL_COLOR, 0, v);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// 输出哈希（FNV-1a 64），用于校验多次运行结果逐位一致
+uint64_t hashTexture(GLuint tex, int w, int h, GLenum fmt, GLenum type, int bytesPerPixel, uint64_t seed) {
+    std::vector<unsigned char> buf(size_t(w) * h * bytesPerPixel);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, fmt, type, buf.data());
+    uint64_t hash = seed;
+    for (unsigned char b : buf) {
+        hash ^= b;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// 设置离屏渲染提示
+static void setOffscreenHints() {
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_NATIVE_CONTEXT_API);
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+}
+
+// 创建离屏渲染上下文
+bool createOffscreenContext(bool verbose) {
+    if (!glfwInit()) {
+        std::cerr << "GLFW Init Failed";
+        return false;
+    }
+
+    setOffscreenHints();
+
+    // 创建1x1的隐藏窗口（最小化资源使用）
+    GLFWwindow *window = glfwCreateWindow(1, 1, "Offscreen Renderer", nullptr, nullptr);
+    if (!window) {
+        std::cerr << "Failed to create offscreen context";
+        glfwTerminate();
+        return false;
+    }
+
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cerr << "GLAD Load Failed";
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return false;
+    }
+
+    if (!verbose) {
+        return true;
+    }
+
+    // 打印系统信息
+    std::cout << "=== System Information ===" << std::endl;
+    std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
+    std::cout << "GPU: " << glGetString(GL_RENDERER) << std::endl;
+    std::cout << "Vendor: " << glGetString(GL_VENDOR) << std::endl;
+    std::cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
+
+    // 查询计算着色器限制
+    GLint maxComputeWorkGroupSize[3];
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 0, &maxComputeWorkGroupSize[0]);
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 1, &maxComputeWorkGroupSize[1]);
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 2, &maxComputeWorkGroupSize[2]);
+    
+    std::cout << "Max Work Group Size: " << maxComputeWorkGroupSize[0] << "x" 
+              << maxComputeWorkGroupSize[1] << "x" << maxComputeWorkGroupSize[2] << std::endl;
+
+    return true;
+}
+
+GLFWwindow *createWorkerContext() {
+    setOffscreenHints();
+    // 函数指针已由 createOffscreenContext 加载，同一驱动的其他上下文可直接复用
+    GLFWwindow *window = glfwCreateWindow(1, 1, "Offscreen Worker", nullptr, nullptr);
+    if (!window) std::cerr << "Failed to create worker context" << std::endl;
+    return window;
+}
@@ -0,0 +1,49 @@
+#pragma once
+// OpenGL 公共工具：着色器编译、纹理加载/保存、离屏上下文
+// offscreen_main / stereogen_bench 等可执行文件共用
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct GLFWwindow;
+
+// 着色器编译工具
+GLuint compileShader(GLenum type, const std::string &source);
+std::string loadFile(const char *path);
+// defines 为若干行 "#define NAME VALUE"，插在 #version 之后，用于编译期特化（如竞争键深度位数）
+GLuint createComputeProgram(const char *path, const std::string &defines = "");
+GLuint createComputeProgramFromSource(const std::string &source); // 链接失败返回 0
+// 图形管线程序（顶点 + 片元着色器），链接失败返回 0；defines 只注入顶点着色器
+GLuint createShaderProgram(const char *vertexPath, const char *fragmentPath, const std::string &defines = "");
+std::string injectDefines(const std::string &source, const std::string &defines);
+// 把 GLES 3.x 计算着色器改写为桌面 GLSL 430（替换 #version、去掉 uint 精度语句），
+// 用于在桌面 / llvmpipe 上运行 android_gles 的着色器
+std::string portESToDesktop(const std::string &source);
+
+// 纹理加载和保存工具
+GLuint loadTextureFromPNG(const char *path, int &width, int &height);
+GLuint loadDepthFromEXR(const char *path, int &width, int &height);
+// 只解码 EXR 第一个通道到 CPU（不创建纹理）
+bool readDepthEXR(const char *path, std::vector<float> &depth, int &width, int &height);
+void saveTexturePNG(GLuint tex, int w, int h, const char *name);
+
+// 从内存创建采样纹理（RGB8 / RGBA8 颜色、R32F 深度），行紧密排列
+GLuint createColorTexture(const uint8_t *pixels, int width, int height, int channels = 3);
+GLuint createDepthTexture(const float *depth, int width, int height);
+
+// 纹理清空：FBO + glClearBuffer，避免上传整幅 CPU 数组
+void clearTextureRGBA8(GLuint tex, uint8_t r, uint8_t g, uint8_t b, uint8_t a = 0);
+void clearTextureR32UI(GLuint tex, uint32_t value);
+void clearTextureRGBA32UI(GLuint tex, uint32_t r, uint32_t g, uint32_t b, uint32_t a = 0);
+
+// 输出哈希（FNV-1a 64），用于校验多次运行结果逐位一致
+uint64_t hashTexture(GLuint tex, int w, int h, GLenum fmt, GLenum type, int bytesPerPixel,
+                     uint64_t seed = 1469598103934665603ull);
+
+// 创建离屏渲染上下文（隐藏窗口 + GL 4.3 core），verbose 时打印系统信息
+bool createOffscreenContext(bool verbose = true);
+// 在 createOffscreenContext 之后、于主线程再建一个独立的隐藏窗口上下文，不设为当前；
+// 工作线程用 glfwMakeContextCurrent 绑定，退出前解绑，再由主线程 glfwDestroyWindow
+GLFWwindow *createWorkerContext();
@@ -342,6 +342,10 @@ const int TILE_W = 256;                       // 与 fill_tile.comp 保持一致
 int numTile = (imageW + TILE_W - 1) / TILE_W; // ⌈W/256⌉
 int edgeW   = numTile * 2;                    // 每 tile 2 像素
 
+// 竞争键低位：容纳 srcX+1（至少 8 位，保证深度位 <= 24）
+int idxBits = 8;
+while ((1 << idxBits) <= imageW) ++idxBits;
+
 //--------------------------------------------------------------------
 // 统一创建 4 张贴图：RGBA8 / R32UI(depth) / R32UI(index) / RGBA32UI(edge)
 //--------------------------------------------------------------------
@@ -404,6 +408,7 @@ makeTarget4(rightColor, rightDepth, rightIndex, rightEdge);
   // ❷ 编译两个 compute shader
   //--------------------------------------------------------------------
   GLuint warpProg = createComputeProgram("warp.comp");   // Pass-A
+  GLuint resolveProg = createComputeProgram("warp_resolve.comp"); // Pass-A'
 
   //--------------------------------------------------------------------
   // ❸ Pass-A : 前向 warp & 记录 index
@@ -420,11 +425,8 @@ makeTarget4(rightColor, rightDepth, rightIndex, rightEdge);
     glBindTexture(GL_TEXTURE_2D, depthTex); // 原图深度
     glUniform1i(glGetUniformLocation(warpProg, "srcDepth"), 1);
 
-    /* --- 输出绑定 --- */
-    glBindImageTexture(2, dstC, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    /* --- 输出绑定：只写竞争键 --- */
     glBindImageTexture(3, dstD, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
-    glBindImageTexture(4, dstI, 0, GL_FALSE, 0, GL_READ_WRITE,
-                       GL_R32UI); // ★ index
 
     /* --- 参数 --- */
     float shiftScale = divergence * 0.01f * imageW * 0.5f * eyeSign;
@@ -436,12 +438,29 @@ makeTarget4(rightColor, rightDepth, rightIndex, rightEdge);
     glUniform1i(glGetUniformLocation(warpProg, "paddedWidth"), paddedW);
     glUniform1f(glGetUniformLocation(warpProg, "shiftScale"), shiftScale);
     glUniform1f(glGetUniformLocation(warpProg, "shiftBias"), shiftBias);
+    glUniform1i(glGetUniformLocation(warpProg, "idxBits"), idxBits);
 
     /* --- Dispatch --- */
     GLuint gx = (paddedW + 15) / 16;
     GLuint gy = (imageH + 15) / 16;
     glDispatchCompute(gx, gy, 1);
     glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    /* --- Pass-A' : 按竞争键回填颜色 / index --- */
+    glUseProgram(resolveProg);
+    glUniform1i(glGetUniformLocation(resolveProg, "srcColor"), 0);
+
+    glBindImageTexture(2, dstC, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    glBindImageTexture(3, dstD, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32UI);
+    glBindImageTexture(4, dstI, 0, GL_FALSE, 0, GL_WRITE_ONLY,
+                       GL_R32UI); // ★ index
+
+    glUniform1i(glGetUniformLocation(resolveProg, "orgWidth"), imageW);
+    glUniform1i(glGetUniformLocation(resolveProg, "orgHeight"), imageH);
+    glUniform1i(glGetUniformLocation(resolveProg, "idxBits"), idxBits);
+
+    glDispatchCompute((imageW + 15) / 16, (imageH + 15) / 16, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
   };
 
   //--------------------------------------------------------------------
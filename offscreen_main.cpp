@@ -3,34 +3,36 @@
 #include <algorithm>
 #include <iostream>
 #include <vector>
-#include <fstream>
-#include <sstream>
 #include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
 
-#define STB_IMAGE_IMPLEMENTATION
+#include "gl_utils.h"
+#include "rgbd_input.h"
 #include "stb_image.h"
-#define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
-#define TINYEXR_USE_MINIZ 0
-#define TINYEXR_USE_STB_ZLIB 1
-#define TINYEXR_IMPLEMENTATION
-#include <tinyexr.h>
+#include "stereo_pipeline.h"
+#include "stripe_stream.h"
+#include "trace.h"
 
 // 性能测试工具
 class PerformanceProfiler {
 private:
     std::vector<std::pair<std::string, double>> timings;
-    std::chrono::high_resolution_clock::time_point startTime;
+    TraceClock::time_point startTime;
 
 public:
     void start() {
-        startTime = std::chrono::high_resolution_clock::now();
+        startTime = TraceClock::now();
     }
     
     void record(const std::string& name) {
-        auto endTime = std::chrono::high_resolution_clock::now();
+        auto endTime = TraceClock::now();
         auto duration = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
         timings.push_back({name, duration.count() / 1000.0}); // 转换为毫秒
+        traceCpuSpan(name.c_str(), startTime, endTime);     // 开启 trace 时同一区间写入时间线
         startTime = endTime;
     }
     
@@ -46,187 +48,178 @@ public:
     }
 };
 
-// 着色器编译工具
-GLuint compileShader(GLenum type, const std::string &source) {
-    GLuint shader = glCreateShader(type);
-    const char *src = source.c_str();
-    glShaderSource(shader, 1, &src, nullptr);
-    glCompileShader(shader);
-
-    GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetShaderInfoLog(shader, 512, nullptr, infoLog);
-        std::cerr << "Shader Compilation Failed:" << infoLog << std::endl;
-    }
-
-    return shader;
-}
-
-std::string loadFile(const char *path) {
-    std::ifstream file(path);
-    std::stringstream ss;
-    ss << file.rdbuf();
-    std::string code = ss.str();
-    std::cout << "[DEBUG] Loaded shader " << path << ", length: " << code.size() << std::endl;
-    return code;
-}
-
-GLuint createComputeProgram(const char *path) {
-    std::string code = loadFile(path);
-    GLuint cs = compileShader(GL_COMPUTE_SHADER, code);
-    GLuint prog = glCreateProgram();
-    glAttachShader(prog, cs);
-    glLinkProgram(prog);
-
-    GLint success;
-    glGetProgramiv(prog, GL_LINK_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetProgramInfoLog(prog, 512, nullptr, infoLog);
-        std::cerr << "Compute Shader Linking Failed:" << infoLog << std::endl;
+// 条带 / 分块模式：CPU 解码整幅，按块流式上传 / 计算 / 读回，显存只按块大小占用
+static int runStriped(PerformanceProfiler &profiler, const std::string &inputPath, const std::string &depthPath,
+                      const StereoParams &params, WarpVariant warp, ColorResolve color, int stripeRows, int tileCols,
+                      int repeat, bool interleaveEyes) {
+    int imageW, imageH, n, depthW, depthH;
+    unsigned char *rgb = stbi_load(inputPath.c_str(), &imageW, &imageH, &n, 3);
+    std::vector<float> depth;
+    if (!rgb || !readDepthEXR(depthPath.c_str(), depth, depthW, depthH) || depthW != imageW || depthH != imageH) {
+        std::cerr << "Input loading failed" << std::endl;
+        if (rgb) stbi_image_free(rgb);
+        return -1;
     }
+    profiler.record("Image Decoding");
 
-    glDeleteShader(cs);
-    return prog;
-}
-
-// 纹理加载和保存工具
-GLuint loadTextureFromPNG(const char *path, int &width, int &height) {
-    int channels;
-    unsigned char *data = stbi_load(path, &width, &height, &channels, 3);
-    if (!data) {
-        std::cerr << "Failed to load image: " << path << std::endl;
-        return 0;
+    StereoPipeline pipeline;
+    if (!pipeline.loadPrograms(warp, FillVariant::TilePrefix, "", ShaderDialect::Desktop, color) ||
+        !pipeline.setOutputFormat(OutputFormat::RGB)) {
+        std::cerr << "Shader compilation failed" << std::endl;
+        stbi_image_free(rgb);
+        return -1;
     }
+    profiler.record("Shader Compilation");
 
-    GLuint texID;
-    glGenTextures(1, &texID);
-    glBindTexture(GL_TEXTURE_2D, texID);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    stbi_image_free(data);
-    return texID;
-}
-
-GLuint loadDepthFromEXR(const char *path, int &width, int &height) {
-    EXRVersion exr_version;
-    int ret = ParseEXRVersionFromFile(&exr_version, path);
-    if (ret != 0) {
-        std::cerr << "Invalid EXR file: " << path << std::endl;
-        return 0;
+    // 先定列块（宽度超限时），再按块宽度定条带高度
+    pipeline.setParams(params);
+    pipeline.setInterleaveEyes(interleaveEyes);
+    int halo = StripeStreamer::haloFor(pipeline, imageW);
+    int cols = StripeStreamer::chooseTileCols(imageW, halo, tileCols);
+    int rows = cols < 0 ? 0 : StripeStreamer::chooseRows(StripeStreamer::blockWidth(imageW, cols, halo), imageH, stripeRows);
+    if (rows <= 0) {
+        std::cerr << "Image width " << imageW << " cannot be tiled within GL limits" << std::endl;
+        pipeline.release();
+        stbi_image_free(rgb);
+        return -1;
     }
-
-    if (exr_version.multipart) {
-        std::cerr << "Multipart EXR not supported.";
-        return 0;
+    std::cout << "Loaded " << inputPath << ": " << imageW << "x" << imageH << ", " << rows << "-row stripes";
+    if (cols > 0) std::cout << ", " << cols << "-column tiles (halo " << halo << ")";
+    std::cout << std::endl;
+
+    StripeStreamer streamer;
+    if (!streamer.begin(pipeline, imageW, rows, cols)) {
+        pipeline.release();
+        stbi_image_free(rgb);
+        return -1;
     }
+    profiler.record("Target Texture Creation");
 
-    EXRHeader exr_header;
-    InitEXRHeader(&exr_header);
-    const char *err = nullptr;
+    std::vector<uint8_t> left(size_t(imageW) * imageH * 3), right(left.size());
+    streamer.run(rgb, depth.data(), imageH, left.data(), right.data());
+    profiler.record("Warp + Fill Blocks");
 
-    ret = ParseEXRHeaderFromFile(&exr_header, &exr_version, path, &err);
-    if (ret != 0) {
-        std::cerr << "Parse EXR err: " << (err ? err : "unknown") << std::endl;
-        FreeEXRErrorMessage(err);
-        return 0;
-    }
+    stbi_write_png("left_eye_filled.png", imageW, imageH, 3, left.data(), imageW * 3);
+    stbi_write_png("right_eye_filled.png", imageW, imageH, 3, right.data(), imageW * 3);
+    profiler.record("Result Saving");
 
-    for (int i = 0; i < exr_header.num_channels; ++i) {
-        if (exr_header.pixel_types[i] == TINYEXR_PIXELTYPE_HALF) {
-            exr_header.requested_pixel_types[i] = TINYEXR_PIXELTYPE_FLOAT;
+    int exitCode = 0;
+    if (repeat > 1) {
+        std::vector<uint8_t> left2(left.size()), right2(right.size());
+        int mismatches = 0;
+        for (int run = 1; run < repeat; ++run) {
+            streamer.run(rgb, depth.data(), imageH, left2.data(), right2.data());
+            if (left2 != left || right2 != right) ++mismatches;
         }
+        std::cout << "Determinism check: " << repeat << " runs" << (mismatches ? ", FAILED" : ", identical")
+                  << std::endl;
+        if (mismatches) exitCode = 1;
+        profiler.record("Determinism Check");
     }
 
-    EXRImage exr_image;
-    InitEXRImage(&exr_image);
-
-    ret = LoadEXRImageFromFile(&exr_image, &exr_header, path, &err);
-    if (ret != 0) {
-        std::cerr << "Load EXR err: " << (err ? err : "unknown") << std::endl;
-        FreeEXRHeader(&exr_header);
-        FreeEXRErrorMessage(err);
-        return 0;
-    }
-
-    width = exr_image.width;
-    height = exr_image.height;
-
-    GLuint texID;
-    glGenTextures(1, &texID);
-    glBindTexture(GL_TEXTURE_2D, texID);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, exr_image.images[0]);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    FreeEXRImage(&exr_image);
-    FreeEXRHeader(&exr_header);
-    return texID;
+    streamer.release();
+    pipeline.release();
+    stbi_image_free(rgb);
+    return exitCode;
 }
 
-void saveTexturePNG(GLuint tex, int w, int h, const char *name) {
-    std::vector<unsigned char> buf(w * h * 3);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_UNSIGNED_BYTE, buf.data());
-    stbi_write_png(name, w, h, 3, buf.data(), w * 3);
-    std::cout << "Saved: " << name << std::endl;
-}
-
-// 创建离屏渲染上下文
-bool createOffscreenContext() {
-    if (!glfwInit()) {
-        std::cerr << "GLFW Init Failed";
-        return false;
-    }
-
-    // 设置离屏渲染提示
-    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
-    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_NATIVE_CONTEXT_API);
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    // 创建1x1的隐藏窗口（最小化资源使用）
-    GLFWwindow *window = glfwCreateWindow(1, 1, "Offscreen Renderer", nullptr, nullptr);
-    if (!window) {
-        std::cerr << "Failed to create offscreen context";
-        glfwTerminate();
-        return false;
-    }
-
-    glfwMakeContextCurrent(window);
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cerr << "GLAD Load Failed";
-        glfwDestroyWindow(window);
-        glfwTerminate();
-        return false;
+int main(int argc, char **argv) {
+    // --repeat N：重复执行 warp+fill 共 N 次并比较输出哈希，校验结果可逐位复现
+    // --trace FILE：写出 Chrome trace JSON（也可用环境变量 STEREOGEN_TRACE）
+    // --input FILE [--depth-input FILE] --layout separate|sbs|tb|alpha --depth-format r8|rg16|rgb24|a8：
+    //   输入布局，默认 image.png + depth.exr；打包布局只解码、上传一次
+    // --stripe ROWS / --tile COLS：按行条带 / 列分块流式处理（仅分离输入）；图像超出纹理 / 工作组上限时自动启用
+    // --vram-budget MB：打印显存规划，整幅超出预算时按条带处理（分离输入），条带也放不下则拒绝
+    // --color eager|deferred|deferred_bilinear|splat：取色方式，默认 eager（最快）；splat 为覆盖率加权的高质量模式
+    // --warp scatter|gather|row|mesh：warp 实现，gather / row 无全局原子操作、输出与 scatter 逐位一致（不支持 splat）；
+    //   mesh 为光栅化行网格，拉伸的三角形盖住空洞，不做 fill（不支持 splat）
+    // --dump-schedule：打印整幅处理时 warp / fill 帧图的调度（分层、交错的 pass 与推导出的 barrier）
+    // --depth-normalize none|minmax|percentile [--depth-percentiles LO,HI]：每帧在 GPU 上统计深度范围并归一化
+    //   （米制 EXR 等任意范围的深度；仅整幅处理），百分位默认 1,99
+    // --save-depth FILE：写出调试深度灰度图（GPU 上按归一化范围转成 8 位后读回）
+    int repeat = 1;
+    bool dumpSchedule = false;
+    int stripeRows = 0, tileCols = 0;
+    size_t budgetBytes = 0;
+    std::string tracePath;
+    std::string inputPath = "image.png", depthPath = "depth.exr";
+    InputLayout layout = InputLayout::Separate;
+    DepthEncoding encoding = DepthEncoding::R8;
+    bool encodingSet = false;
+    ColorResolve color = ColorResolve::Eager;
+    WarpVariant warp = WarpVariant::Scatter;
+    DepthNormalize depthNorm = DepthNormalize::None;
+    float lowPercent = 1.0f, highPercent = 99.0f;
+    std::string depthPreviewPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--stripe" && i + 1 < argc) {
+            stripeRows = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--tile" && i + 1 < argc) {
+            tileCols = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--vram-budget" && i + 1 < argc) {
+            budgetBytes = size_t(std::max(0, std::atoi(argv[++i]))) << 20;
+        } else if (arg == "--color" && i + 1 < argc) {
+            if (!parseColorResolve(argv[++i], color)) {
+                std::cerr << "Unknown color resolve: " << argv[i] << std::endl;
+                return -1;
+            }
+        } else if (arg == "--warp" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "scatter") {
+                warp = WarpVariant::Scatter;
+            } else if (name == "gather") {
+                warp = WarpVariant::Gather;
+            } else if (name == "row") {
+                warp = WarpVariant::RowScatter;
+            } else if (name == "mesh") {
+                warp = WarpVariant::Mesh;
+            } else {
+                std::cerr << "Unknown warp: " << name << std::endl;
+                return -1;
+            }
+        } else if (arg == "--dump-schedule") {
+            dumpSchedule = true;
+        } else if (arg == "--depth-normalize" && i + 1 < argc) {
+            if (!parseDepthNormalize(argv[++i], depthNorm)) {
+                std::cerr << "Unknown depth normalization: " << argv[i] << std::endl;
+                return -1;
+            }
+        } else if (arg == "--depth-percentiles" && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%f,%f", &lowPercent, &highPercent) != 2 || lowPercent < 0.0f ||
+                highPercent > 100.0f || lowPercent >= highPercent) {
+                std::cerr << "Invalid percentiles: " << argv[i] << std::endl;
+                return -1;
+            }
+        } else if (arg == "--save-depth" && i + 1 < argc) {
+            depthPreviewPath = argv[++i];
+        } else if (arg == "--input" && i + 1 < argc) {
+            inputPath = argv[++i];
+        } else if (arg == "--depth-input" && i + 1 < argc) {
+            depthPath = argv[++i];
+        } else if (arg == "--layout" && i + 1 < argc) {
+            if (!parseInputLayout(argv[++i], layout)) {
+                std::cerr << "Unknown layout: " << argv[i] << std::endl;
+                return -1;
+            }
+        } else if (arg == "--depth-format" && i + 1 < argc) {
+            if (!parseDepthEncoding(argv[++i], encoding)) {
+                std::cerr << "Unknown depth format: " << argv[i] << std::endl;
+                return -1;
+            }
+            encodingSet = true;
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return -1;
+        }
     }
 
-    // 打印系统信息
-    std::cout << "=== System Information ===" << std::endl;
-    std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
-    std::cout << "GPU: " << glGetString(GL_RENDERER) << std::endl;
-    std::cout << "Vendor: " << glGetString(GL_VENDOR) << std::endl;
-    std::cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
-
-    // 查询计算着色器限制
-    GLint maxComputeWorkGroupSize[3];
-    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 0, &maxComputeWorkGroupSize[0]);
-    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 1, &maxComputeWorkGroupSize[1]);
-    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 2, &maxComputeWorkGroupSize[2]);
-    
-    std::cout << "Max Work Group Size: " << maxComputeWorkGroupSize[0] << "x" 
-              << maxComputeWorkGroupSize[1] << "x" << maxComputeWorkGroupSize[2] << std::endl;
-
-    return true;
-}
+    traceInit(tracePath);
 
-int main() {
     PerformanceProfiler profiler;
     profiler.start();
 
@@ -236,181 +229,162 @@ int main() {
     }
     profiler.record("Context Creation");
 
-    // 获取图像尺寸
-    int imageW, imageH, channels;
-    unsigned char *info_data = stbi_load("image.png", &imageW, &imageH, &channels, 0);
-    if (info_data) {
-        stbi_image_free(info_data);
-        std::cout << "Image Size: " << imageW << "x" << imageH << std::endl;
-    } else {
-        std::cout << "Cannot get image info, using default size: 1920x1080" << std::endl;
-        imageW = 1920;
-        imageH = 1080;
+    // 参数设置
+    StereoParams params;
+    params.divergence = 2.0f;
+    params.convergence = 0.0f;
+
+    // 显存预算：按单幅尺寸规划，打包输入不能拆条带。有预算时两眼共用竞争键 / edge（两眼串行，省一份）
+    bool interleaveEyes = budgetBytes == 0;
+    int infoW, infoH, infoN;
+    bool haveInfo = stbi_info(inputPath.c_str(), &infoW, &infoH, &infoN) != 0;
+    if (budgetBytes > 0 && haveInfo) {
+        int frameW = layout == InputLayout::SideBySide ? infoW / 2 : infoW;
+        int frameH = layout == InputLayout::TopBottom ? infoH / 2 : infoH;
+        VramPlan plan =
+            planVram(frameW, frameH, budgetBytes, layout == InputLayout::Separate && warp != WarpVariant::Mesh, color, warp,
+                     interleaveEyes);
+        printVramPlan(std::cout, plan, frameW, frameH, budgetBytes);
+        if (!plan.fits) {
+            std::cerr << "Image exceeds VRAM budget" << std::endl;
+            return -1;
+        }
+        if (plan.stripeRows > 0) stripeRows = stripeRows > 0 ? std::min(stripeRows, plan.stripeRows) : plan.stripeRows;
     }
-    profiler.record("Image Info Loading");
 
-    // 加载纹理
-    GLuint imageTex = loadTextureFromPNG("image.png", imageW, imageH);
-    std::cout << "Loaded image.png: " << imageW << "x" << imageH << std::endl;
+    // 超出上限或指定了条带 / 列块时走分块流程（rows 为 0 表示单行就超出上限，需要列分块）
+    if (layout == InputLayout::Separate && haveInfo) {
+        int rows = StripeStreamer::chooseRows(infoW, infoH, stripeRows);
+        if (rows < infoH || tileCols > 0) {
+            // 每块各自统计范围会让块间深度不一致
+            if (depthNorm != DepthNormalize::None) {
+                std::cerr << "--depth-normalize needs whole-image processing" << std::endl;
+                return -1;
+            }
+            // 光栅化随窗口平移舍入不同，分块的 mesh 与整幅不能逐位一致
+            if (warp == WarpVariant::Mesh) {
+                std::cerr << "--warp mesh needs whole-image processing" << std::endl;
+                return -1;
+            }
+            int exitCode =
+                runStriped(profiler, inputPath, depthPath, params, warp, color, stripeRows, tileCols, repeat,
+                           interleaveEyes);
+            traceShutdown();
+            glfwTerminate();
+            profiler.record("Resource Cleanup");
+            profiler.printReport();
+            return exitCode;
+        }
+    } else if (stripeRows > 0 || tileCols > 0) {
+        std::cerr << "--stripe / --tile support separate input only" << std::endl;
+        return -1;
+    }
 
-    int depthW, depthH;
-    GLuint depthTex = loadDepthFromEXR("depth.exr", depthW, depthH);
-    if (depthTex == 0) {
-        std::cerr << "Depth texture loading failed";
+    // 加载输入
+    if (layout == InputLayout::ColorAlpha && !encodingSet) {
+        encoding = DepthEncoding::A8;
+    }
+    RGBDInput input;
+    bool loaded = layout == InputLayout::Separate
+                      ? loadSeparateRGBD(inputPath.c_str(), depthPath.c_str(), input)
+                      : loadPackedRGBD(inputPath.c_str(), layout, encoding, input);
+    if (!loaded) {
+        std::cerr << "Input loading failed" << std::endl;
         return -1;
-    } else {
-        std::cout << "Loaded depth.exr: " << depthW << "x" << depthH << std::endl;
     }
+    int imageW = input.width, imageH = input.height;
+    std::cout << "Loaded " << inputPath << ": " << imageW << "x" << imageH << std::endl;
     profiler.record("Texture Loading");
 
-    // 参数设置
-    const float divergence = 2.0f;
-    const float convergence = 0.0f;
-    int padSize = int(imageW * divergence * 0.01f + 2);
-    int paddedW = imageW + padSize * 2;
-
-    // 全局尺寸
-    const int TILE_W = 256;
-    int numTile = (imageW + TILE_W - 1) / TILE_W;
-    int edgeW = numTile * 2;
+    // 编译着色器
+    StereoPipeline pipeline;
+    pipeline.setDepthNormalize(depthNorm, lowPercent, highPercent);
+    if (!pipeline.loadPrograms(warp, FillVariant::TilePrefix, "", ShaderDialect::Desktop, color)) {
+        std::cerr << "Shader compilation failed" << std::endl;
+        return -1;
+    }
+    // PNG 只需要 RGB：fill 末尾在 GPU 上打包，读回比 RGBA 少 1/4
+    if (!pipeline.setOutputFormat(OutputFormat::RGB)) {
+        std::cerr << "Shader compilation failed" << std::endl;
+        return -1;
+    }
+    profiler.record("Shader Compilation");
 
     // 创建目标纹理
-    GLuint leftColor, leftDepth, leftIndex, leftEdge;
-    GLuint rightColor, rightDepth, rightIndex, rightEdge;
-
-    auto makeTarget4 = [&](GLuint &color, GLuint &depth, GLuint &index, GLuint &edge) {
-        glGenTextures(1, &color);
-        glBindTexture(GL_TEXTURE_2D, color);
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, imageW, imageH);
-
-        glGenTextures(1, &depth);
-        glBindTexture(GL_TEXTURE_2D, depth);
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, imageW, imageH);
-
-        glGenTextures(1, &index);
-        glBindTexture(GL_TEXTURE_2D, index);
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, imageW, imageH);
-
-        glGenTextures(1, &edge);
-        glBindTexture(GL_TEXTURE_2D, edge);
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32UI, edgeW, imageH);
-
-        // 初始化纹理
-        std::vector<uint8_t> clrInit(imageW * imageH * 4, 0);
-        std::vector<uint32_t> u32Zero(imageW * imageH, 0);
-        std::vector<uint32_t> u32Undef(imageW * imageH, 0xFFFFFFFFu);
-        std::vector<uint32_t> edgeZero(edgeW * imageH * 4, 0);
-
-        glBindTexture(GL_TEXTURE_2D, color);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, imageW, imageH, GL_RGBA, GL_UNSIGNED_BYTE, clrInit.data());
-
-        glBindTexture(GL_TEXTURE_2D, depth);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, imageW, imageH, GL_RED_INTEGER, GL_UNSIGNED_INT, u32Zero.data());
-
-        glBindTexture(GL_TEXTURE_2D, index);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, imageW, imageH, GL_RED_INTEGER, GL_UNSIGNED_INT, u32Undef.data());
-
-        glBindTexture(GL_TEXTURE_2D, edge);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, edgeW, imageH, GL_RGBA_INTEGER, GL_UNSIGNED_INT, edgeZero.data());
-    };
-
-    makeTarget4(leftColor, leftDepth, leftIndex, leftEdge);
-    makeTarget4(rightColor, rightDepth, rightIndex, rightEdge);
+    pipeline.setParams(params);
+    pipeline.setInterleaveEyes(interleaveEyes);
+    pipeline.allocateTargets(imageW, imageH);
+    if (!pipeline.setSource(input)) {
+        input.release();
+        pipeline.release();
+        return -1;
+    }
     profiler.record("Target Texture Creation");
 
-    // 编译着色器
-    GLuint warpProg = createComputeProgram("warp.comp");
-    GLuint tileProg = createComputeProgram("fill_tile.comp");
-    GLuint prefixProg = createComputeProgram("fill_prefix.comp");
-    profiler.record("Shader Compilation");
-
     // Warp阶段
-    auto warpEye = [&](GLuint dstC, GLuint dstD, GLuint dstI, int eyeSign) {
-        glUseProgram(warpProg);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, imageTex);
-        glUniform1i(glGetUniformLocation(warpProg, "srcColor"), 0);
-
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, depthTex);
-        glUniform1i(glGetUniformLocation(warpProg, "srcDepth"), 1);
-
-        glBindImageTexture(2, dstC, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
-        glBindImageTexture(3, dstD, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
-        glBindImageTexture(4, dstI, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
-
-        float shiftScale = divergence * 0.01f * imageW * 0.5f * eyeSign;
-        float shiftBias = -convergence * shiftScale;
-
-        glUniform1i(glGetUniformLocation(warpProg, "orgWidth"), imageW);
-        glUniform1i(glGetUniformLocation(warpProg, "orgHeight"), imageH);
-        glUniform1i(glGetUniformLocation(warpProg, "padSize"), padSize);
-        glUniform1i(glGetUniformLocation(warpProg, "paddedWidth"), paddedW);
-        glUniform1f(glGetUniformLocation(warpProg, "shiftScale"), shiftScale);
-        glUniform1f(glGetUniformLocation(warpProg, "shiftBias"), shiftBias);
-
-        GLuint gx = (paddedW + 15) / 16;
-        GLuint gy = (imageH + 15) / 16;
-        glDispatchCompute(gx, gy, 1);
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-    };
-
-    warpEye(leftColor, leftDepth, leftIndex, +1);
-    warpEye(rightColor, rightDepth, rightIndex, -1);
+    pipeline.warp();
     profiler.record("Warp Stage");
 
     // Fill阶段
-    auto fillEye = [&](GLuint color, GLuint index, GLuint edge, int eyeSign) {
-        glUseProgram(tileProg);
-        glBindImageTexture(2, color, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8);
-        glBindImageTexture(4, index, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
-        glBindImageTexture(5, edge, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32UI);
-
-        glUniform1i(glGetUniformLocation(tileProg, "orgWidth"), imageW);
-        glUniform1i(glGetUniformLocation(tileProg, "orgHeight"), imageH);
-        glUniform1i(glGetUniformLocation(tileProg, "eyeSign"), eyeSign);
-
-        glDispatchCompute(numTile, imageH, 1);
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-
-        glUseProgram(prefixProg);
-        glBindImageTexture(2, color, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8);
-        glBindImageTexture(4, index, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
-        glBindImageTexture(5, edge, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32UI);
-
-        glUniform1i(glGetUniformLocation(prefixProg, "orgWidth"), imageW);
-        glUniform1i(glGetUniformLocation(prefixProg, "orgHeight"), imageH);
-        glUniform1i(glGetUniformLocation(prefixProg, "numTile"), numTile);
-
-        glDispatchCompute(1, imageH, 1);
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-    };
-
-    fillEye(leftColor, leftIndex, leftEdge, +1);
-    fillEye(rightColor, rightIndex, rightEdge, -1);
+    pipeline.fill();
     profiler.record("Fill Stage");
+    if (dumpSchedule) pipeline.dumpSchedule(std::cout);
+    DepthRange range;
+    if (pipeline.readDepthRange(range)) {
+        std::cout << "Depth range: " << range.min << ".." << range.max << ", normalized " << range.lo << ".."
+                  << range.hi << " (" << variantName(depthNorm) << ")" << std::endl;
+    }
 
     // 保存结果
-    saveTexturePNG(leftColor, imageW, imageH, "left_eye_filled.png");
-    saveTexturePNG(rightColor, imageW, imageH, "right_eye_filled.png");
+    std::vector<uint8_t> eyes[2];
+    for (std::vector<uint8_t> &eye : eyes) eye.resize(outputBytes(OutputFormat::RGB, imageW, imageH));
+    pipeline.readOutput(eyes[0].data(), eyes[1].data());
+    const char *eyeNames[2] = {"left_eye_filled.png", "right_eye_filled.png"};
+    for (int i = 0; i < 2; ++i) {
+        stbi_write_png(eyeNames[i], imageW, imageH, 3, eyes[i].data(), imageW * 3);
+        std::cout << "Saved: " << eyeNames[i] << std::endl;
+    }
+    std::vector<uint8_t> depthGray;
+    if (!depthPreviewPath.empty() && pipeline.readDepthPreview(depthGray)) {
+        stbi_write_png(depthPreviewPath.c_str(), imageW, imageH, 1, depthGray.data(), imageW);
+        std::cout << "Saved: " << depthPreviewPath << std::endl;
+    }
     profiler.record("Result Saving");
 
+    // 确定性校验：竞争键在 warp 内清零，颜色/索引由回填 pass 整幅重写，edge 由 fill_tile 整幅重写
+    int exitCode = 0;
+    if (repeat > 1) {
+        auto hashOutputs = [&]() {
+            uint64_t h = hashTexture(pipeline.left.color, imageW, imageH, GL_RGBA, GL_UNSIGNED_BYTE, 4);
+            h = hashTexture(pipeline.right.color, imageW, imageH, GL_RGBA, GL_UNSIGNED_BYTE, 4, h);
+            h = hashTexture(pipeline.left.index, imageW, imageH, GL_RED_INTEGER, GL_UNSIGNED_INT, 4, h);
+            return hashTexture(pipeline.right.index, imageW, imageH, GL_RED_INTEGER, GL_UNSIGNED_INT, 4, h);
+        };
+
+        uint64_t reference = hashOutputs();
+        int mismatches = 0;
+        for (int run = 1; run < repeat; ++run) {
+            pipeline.resetTargets();
+            pipeline.warp();
+            pipeline.fill();
+            uint64_t h = hashOutputs();
+            if (h != reference) {
+                std::cerr << "Determinism check: run " << run + 1 << " hash " << std::hex << h
+                          << " != " << reference << std::dec << std::endl;
+                ++mismatches;
+            }
+        }
+        std::cout << "Determinism check: " << repeat << " runs, hash " << std::hex << reference << std::dec
+                  << (mismatches ? ", FAILED" : ", identical") << std::endl;
+        if (mismatches) exitCode = 1;
+        profiler.record("Determinism Check");
+    }
+
     // 清理资源
-    glDeleteTextures(1, &imageTex);
-    glDeleteTextures(1, &depthTex);
-    glDeleteTextures(1, &leftColor);
-    glDeleteTextures(1, &leftDepth);
-    glDeleteTextures(1, &leftIndex);
-    glDeleteTextures(1, &leftEdge);
-    glDeleteTextures(1, &rightColor);
-    glDeleteTextures(1, &rightDepth);
-    glDeleteTextures(1, &rightIndex);
-    glDeleteTextures(1, &rightEdge);
-    glDeleteProgram(warpProg);
-    glDeleteProgram(tileProg);
-    glDeleteProgram(prefixProg);
+    input.release();
+    pipeline.release();
 
+    traceShutdown();
     glfwTerminate();
     profiler.record("Resource Cleanup");
 
@@ -418,5 +392,5 @@ int main() {
     profiler.printReport();
     
     std::cout << "Stereo image generation completed!" << std::endl;
-    return 0;
+    return exitCode;
 } 
\ No newline at end of file
@@ -0,0 +1,987 @@
+// stereogen_regress：在固定语料上运行所有 warp/fill 变体，与 golden 输出逐像素比较
+// 超出阈值（差异像素比例 / PSNR）即返回非 0；--update-golden 重新生成 golden
+// 只依赖 GL 4.3 计算着色器，可在 Mesa llvmpipe 上无 GPU 运行
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "stb_image.h"
+#include "stb_image_write.h"
+#include "gl_utils.h"
+#include "frame_batch.h"
+#include "stereo_pipeline.h"
+#include "stripe_stream.h"
+#include "synthetic_scenes.h"
+#include "trace.h"
+
+#ifndef STEREOGEN_SOURCE_DIR
+#define STEREOGEN_SOURCE_DIR "."
+#endif
+
+// 打包纹理中深度的编码方式（与 android_gles/assets 下的 SBS 素材对应）
+enum class DepthPacking {
+    R8,    // sbs_depth.png：R 通道
+    RG16,  // sbs_depthrg.png：R 高 8 位、G 低 8 位
+    RGB24, // sbs_depthrgb.png：R 高、G 中、B 低
+};
+
+static float decodeDepth(const uint8_t *p, DepthPacking packing) {
+    switch (packing) {
+    case DepthPacking::R8: return p[0] / 255.0f;
+    case DepthPacking::RG16: return ((p[0] << 8) | p[1]) / 65535.0f;
+    case DepthPacking::RGB24: return float((p[0] << 16) | (p[1] << 8) | p[2]) / 16777215.0f;
+    }
+    return 0.0f;
+}
+
+// 颜色 PNG + EXR 深度
+static bool loadSeparate(const std::string &colorPath, const std::string &depthPath, RGBDImage &img) {
+    int w, h, n;
+    uint8_t *rgb = stbi_load(colorPath.c_str(), &w, &h, &n, 3);
+    if (!rgb) return false;
+    img.width = w;
+    img.height = h;
+    img.rgb.assign(rgb, rgb + size_t(w) * h * 3);
+    stbi_image_free(rgb);
+
+    int dw, dh;
+    if (!readDepthEXR(depthPath.c_str(), img.depth, dw, dh)) return false;
+    if (dw != w || dh != h) {
+        std::cerr << depthPath << ": size " << dw << "x" << dh << " != " << w << "x" << h << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// RGBA PNG，A 通道为 8 位深度
+static bool loadRGBA(const std::string &path, RGBDImage &img) {
+    int w, h, n;
+    uint8_t *rgba = stbi_load(path.c_str(), &w, &h, &n, 4);
+    if (!rgba) return false;
+    img.width = w;
+    img.height = h;
+    img.rgb.resize(size_t(w) * h * 3);
+    img.depth.resize(size_t(w) * h);
+    for (size_t i = 0; i < size_t(w) * h; ++i) {
+        std::copy_n(rgba + i * 4, 3, &img.rgb[i * 3]);
+        img.depth[i] = rgba[i * 4 + 3] / 255.0f;
+    }
+    stbi_image_free(rgba);
+    return true;
+}
+
+// SBS PNG：左半颜色，右半按 packing 编码的深度
+static bool loadSBS(const std::string &path, DepthPacking packing, RGBDImage &img) {
+    int w2, h, n;
+    uint8_t *sbs = stbi_load(path.c_str(), &w2, &h, &n, 3);
+    if (!sbs) return false;
+    int w = w2 / 2;
+    img.width = w;
+    img.height = h;
+    img.rgb.resize(size_t(w) * h * 3);
+    img.depth.resize(size_t(w) * h);
+    for (int y = 0; y < h; ++y) {
+        const uint8_t *row = sbs + size_t(y) * w2 * 3;
+        std::copy_n(row, size_t(w) * 3, &img.rgb[size_t(y) * w * 3]);
+        for (int x = 0; x < w; ++x)
+            img.depth[size_t(y) * w + x] = decodeDepth(row + (w + x) * 3, packing);
+    }
+    stbi_image_free(sbs);
+    return true;
+}
+
+// 最近邻缩小：llvmpipe 上 1080p 的 tile_prefix 填充需要近一分钟，语料默认缩到 1/4
+static RGBDImage downscale(const RGBDImage &src, int factor) {
+    if (factor <= 1) return src;
+    RGBDImage dst;
+    dst.width = src.width / factor;
+    dst.height = src.height / factor;
+    dst.rgb.resize(size_t(dst.width) * dst.height * 3);
+    dst.depth.resize(size_t(dst.width) * dst.height);
+    for (int y = 0; y < dst.height; ++y)
+        for (int x = 0; x < dst.width; ++x) {
+            size_t s = size_t(y * factor) * src.width + x * factor;
+            size_t d = size_t(y) * dst.width + x;
+            std::copy_n(&src.rgb[s * 3], 3, &dst.rgb[d * 3]);
+            dst.depth[d] = src.depth[s];
+        }
+    return dst;
+}
+
+struct CorpusEntry {
+    const char *name;
+    std::function<bool(const std::string &root, RGBDImage &img)> load;
+};
+
+static const std::vector<CorpusEntry> &corpus() {
+    static const std::vector<CorpusEntry> entries = {
+        {"image_exr", [](const std::string &r, RGBDImage &img) { return loadSeparate(r + "/image.png", r + "/depth.exr", img); }},
+        {"rgb_depth", [](const std::string &r, RGBDImage &img) { return loadRGBA(r + "/rgb_depth.png", img); }},
+        {"sbs_depth", [](const std::string &r, RGBDImage &img) {
+             return loadSBS(r + "/android_gles/assets/sbs_depth.png", DepthPacking::R8, img);
+         }},
+        {"sbs_depthrg", [](const std::string &r, RGBDImage &img) {
+             return loadSBS(r + "/android_gles/assets/sbs_depthrg.png", DepthPacking::RG16, img);
+         }},
+        {"sbs_depthrgb", [](const std::string &r, RGBDImage &img) {
+             return loadSBS(r + "/android_gles/assets/sbs_depthrgb.png", DepthPacking::RGB24, img);
+         }},
+    };
+    return entries;
+}
+
+struct RegressVariant {
+    const char *name;
+    WarpVariant warp;
+    FillVariant fill;
+    ShaderDialect dialect;
+    const char *shaderDir; // 相对源码根目录
+    ColorResolve color;
+};
+
+static const RegressVariant kVariants[] = {
+    {"scatter+tile_prefix", WarpVariant::Scatter, FillVariant::TilePrefix, ShaderDialect::Desktop, "", ColorResolve::Eager},
+    {"split+log_shift", WarpVariant::SplitPass, FillVariant::LogShift, ShaderDialect::Desktop, "OpenGLStereoGenerator/shaders",
+     ColorResolve::Eager},
+    {"split+log_shift_es", WarpVariant::SplitPass, FillVariant::LogShift, ShaderDialect::GLES, "android_gles/shaders",
+     ColorResolve::Eager},
+    {"scatter+tile_prefix+deferred", WarpVariant::Scatter, FillVariant::TilePrefix, ShaderDialect::Desktop, "",
+     ColorResolve::Deferred},
+    {"scatter+tile_prefix+deferred_bilinear", WarpVariant::Scatter, FillVariant::TilePrefix, ShaderDialect::Desktop, "",
+     ColorResolve::DeferredBilinear},
+    {"scatter+tile_prefix+splat", WarpVariant::Scatter, FillVariant::TilePrefix, ShaderDialect::Desktop, "",
+     ColorResolve::Splat},
+    {"gather+tile_prefix", WarpVariant::Gather, FillVariant::TilePrefix, ShaderDialect::Desktop, "", ColorResolve::Eager},
+    {"split_gather+log_shift", WarpVariant::SplitGather, FillVariant::LogShift, ShaderDialect::Desktop,
+     "OpenGLStereoGenerator/shaders", ColorResolve::Eager},
+    {"row+tile_prefix", WarpVariant::RowScatter, FillVariant::TilePrefix, ShaderDialect::Desktop, "", ColorResolve::Eager},
+    {"mesh", WarpVariant::Mesh, FillVariant::TilePrefix, ShaderDialect::Desktop, "", ColorResolve::Eager},
+};
+
+struct DiffStats {
+    double diffPercent = 0; // 任一通道差超过 tol 的像素比例
+    double psnr = 0;        // 全通道 PSNR，完全一致时为 inf
+    int maxDelta = 0;
+};
+
+static DiffStats compareRGB(const uint8_t *a, const uint8_t *b, size_t pixels, int tol) {
+    DiffStats st;
+    size_t diffPx = 0;
+    double sq = 0;
+    for (size_t i = 0; i < pixels; ++i) {
+        int worst = 0;
+        for (int c = 0; c < 3; ++c) {
+            int d = std::abs(int(a[i * 3 + c]) - int(b[i * 3 + c]));
+            worst = std::max(worst, d);
+            sq += double(d) * d;
+        }
+        if (worst > tol) ++diffPx;
+        st.maxDelta = std::max(st.maxDelta, worst);
+    }
+    st.diffPercent = pixels ? 100.0 * diffPx / pixels : 0.0;
+    double mse = pixels ? sq / (pixels * 3.0) : 0.0;
+    st.psnr = mse > 0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : INFINITY;
+    return st;
+}
+
+static std::string formatStats(const DiffStats &st) {
+    std::ostringstream o;
+    o << std::fixed << std::setprecision(3) << st.diffPercent << "% px, PSNR ";
+    if (std::isinf(st.psnr))
+        o << "inf";
+    else
+        o << std::setprecision(2) << st.psnr << " dB";
+    o << ", max delta " << st.maxDelta;
+    return o.str();
+}
+
+static std::vector<uint8_t> readRGB(GLuint tex, int w, int h) {
+    std::vector<uint8_t> buf(size_t(w) * h * 3);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_UNSIGNED_BYTE, buf.data());
+    return buf;
+}
+
+static std::vector<uint8_t> readRGBA(GLuint tex, int w, int h) {
+    std::vector<uint8_t> buf(size_t(w) * h * 4);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, buf.data());
+    return buf;
+}
+
+// 与 pack_output.comp 相同的打包：YUV 为 BT.601 有限范围（libyuv 系数），色度取 2x2 块内存在像素的平均
+static std::vector<uint8_t> packOutputCPU(const std::vector<uint8_t> &rgba, int w, int h, OutputFormat format) {
+    std::vector<uint8_t> out(outputBytes(format, w, h));
+    size_t pixels = size_t(w) * h;
+    if (format == OutputFormat::RGBA) return rgba;
+    if (format == OutputFormat::RGB || format == OutputFormat::BGRA) {
+        bool bgra = format == OutputFormat::BGRA;
+        int bpp = bgra ? 4 : 3;
+        for (size_t i = 0; i < pixels; ++i) {
+            const uint8_t *c = &rgba[i * 4];
+            uint8_t *o = &out[i * bpp];
+            o[0] = bgra ? c[2] : c[0];
+            o[1] = c[1];
+            o[2] = bgra ? c[0] : c[2];
+            if (bgra) o[3] = c[3];
+        }
+        return out;
+    }
+    for (size_t i = 0; i < pixels; ++i) {
+        const uint8_t *c = &rgba[i * 4];
+        out[i] = uint8_t((66 * c[0] + 129 * c[1] + 25 * c[2] + 0x1080) >> 8);
+    }
+    int cw = (w + 1) / 2, ch = (h + 1) / 2;
+    uint8_t *u = &out[pixels];
+    uint8_t *v = format == OutputFormat::I420 ? u + size_t(cw) * ch : u + 1;
+    int step = format == OutputFormat::I420 ? 1 : 2;
+    for (int cy = 0; cy < ch; ++cy) {
+        for (int cx = 0; cx < cw; ++cx) {
+            int sum[3] = {0, 0, 0}, n = 0;
+            for (int y = cy * 2; y < std::min(cy * 2 + 2, h); ++y) {
+                for (int x = cx * 2; x < std::min(cx * 2 + 2, w); ++x) {
+                    for (int k = 0; k < 3; ++k) sum[k] += rgba[(size_t(y) * w + x) * 4 + k];
+                    ++n;
+                }
+            }
+            int r = (sum[0] + n / 2) / n, g = (sum[1] + n / 2) / n, b = (sum[2] + n / 2) / n;
+            size_t o = (size_t(cy) * cw + cx) * step;
+            u[o] = uint8_t((112 * b - 74 * g - 38 * r + 0x8080) >> 8);
+            v[o] = uint8_t((112 * r - 94 * g - 18 * b + 0x8080) >> 8);
+        }
+    }
+    return out;
+}
+
+// 竞争键精度报告用的 SBS 纹理：RGB32F，右半 R 通道保留语料的原始深度精度（packSideBySide 会量化到 8 位）
+static GLuint createFloatSBSTexture(const RGBDImage &img) {
+    const int w = img.width, h = img.height;
+    std::vector<float> sbs(size_t(w) * 2 * h * 3, 0.0f);
+    for (int y = 0; y < h; ++y) {
+        float *row = &sbs[size_t(y) * w * 2 * 3];
+        for (int x = 0; x < w * 3; ++x)
+            row[x] = img.rgb[size_t(y) * w * 3 + x] / 255.0f;
+        for (int x = 0; x < w; ++x)
+            row[(w + x) * 3] = img.depth[size_t(y) * w + x];
+    }
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, w * 2, h, 0, GL_RGB, GL_FLOAT, sbs.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return tex;
+}
+
+static std::vector<std::string> splitList(const std::string &s) {
+    std::vector<std::string> items;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty()) items.push_back(item);
+    return items;
+}
+
+struct RegressOptions {
+    std::string root = STEREOGEN_SOURCE_DIR;
+    std::string golden; // 默认 <root>/regress/golden
+    std::string out = "regress_out";
+    std::vector<std::string> entries, variants;
+    int scale = 4;
+    float divergence = 2.0f;
+    int tol = 2;
+    double maxDiffPercent = 0.5;
+    double minPsnr = 40.0;
+    bool update = false;
+    std::vector<int> keyBits; // 竞争键精度报告（SplitPass 深度位数），为空时跳过
+    bool goldenOnly = false;  // 只做 golden 比对，跳过逐位一致检查
+    int batch = 3;            // 逐位一致检查中多帧批处理的帧数，0 时跳过
+};
+
+static void printUsage() {
+    std::cout << "Usage: stereogen_regress [options]\n"
+              << "  --root DIR          source tree with corpus and shaders (default " << STEREOGEN_SOURCE_DIR << ")\n"
+              << "  --golden DIR        golden directory (default <root>/regress/golden)\n"
+              << "  --out DIR           write failing outputs here (default regress_out)\n"
+              << "  --entries LIST      image_exr,rgb_depth,sbs_depth,sbs_depthrg,sbs_depthrgb (default all)\n"
+              << "  --variants LIST     scatter+tile_prefix,split+log_shift,split+log_shift_es,\n"
+              << "                      scatter+tile_prefix+deferred,scatter+tile_prefix+deferred_bilinear,\n"
+              << "                      scatter+tile_prefix+splat,gather+tile_prefix,split_gather+log_shift,\n"
+              << "                      row+tile_prefix,mesh\n"
+              << "                      (default all; golden comparison only)\n"
+              << "  --scale N           downscale corpus by N (default 4)\n"
+              << "  --div D             divergence in % (default 2)\n"
+              << "  --tol N             per-channel tolerance before a pixel counts as different (default 2)\n"
+              << "  --max-diff P        max % of differing pixels (default 0.5)\n"
+              << "  --min-psnr DB       min PSNR vs golden (default 40)\n"
+              << "  --update-golden     overwrite golden outputs with current results\n"
+              << "  --golden-only       skip the exact-equality checks below\n"
+              << "  --batch K           frames per batch in the batch check (default 3, 0 skips it)\n"
+              << "  --key-bits LIST     also report split+log_shift key contention / ties at these depth bits (8..16),\n"
+              << "                      e.g. 8,12,16 (report only; outputs compared against the last entry)\n"
+              << "Exact-equality checks (run by default; any differing pixel or byte is a failure):\n"
+              << "  fill bound          scatter+tile_prefix and split+log_shift with and without the disparity bound\n"
+              << "                      on fill propagation (also reports fill barriers per frame)\n"
+              << "  shared disparity    scatter+tile_prefix and split+log_shift with and without the shared\n"
+              << "                      disparity pre-pass\n"
+              << "  depth norm          root-shader variants on metric-scaled depth with GPU min/max (scatter+tile_prefix\n"
+              << "                      also percentile) normalization; the range must match the CPU, outputs must match\n"
+              << "                      CPU-normalized input, and so must the depth preview\n"
+              << "  output formats      scatter+tile_prefix outputs packed on the GPU as rgb / bgra / nv12 / i420\n"
+              << "                      (full size and an odd-sized crop) vs packing the RGBA readback on the CPU\n"
+              << "  batch               K copies of each entry (divergence / convergence varying per frame) as one\n"
+              << "                      array-texture batch vs scatter+tile_prefix frame by frame\n"
+              << "  streaming           every variant on each entry widened by its mirror image, through StripeStreamer\n"
+              << "                      with 37-row stripes (not dividing the height) and 256-column tiles (stripes only\n"
+              << "                      for deferred color) vs the whole image; mesh, split variants and deferred column\n"
+              << "                      tiles must be refused\n";
+}
+
+static bool parseOptions(int argc, char **argv, RegressOptions &opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return false;
+        } else if (arg == "--root" && hasValue) {
+            opt.root = argv[++i];
+        } else if (arg == "--golden" && hasValue) {
+            opt.golden = argv[++i];
+        } else if (arg == "--out" && hasValue) {
+            opt.out = argv[++i];
+        } else if (arg == "--entries" && hasValue) {
+            opt.entries = splitList(argv[++i]);
+        } else if (arg == "--variants" && hasValue) {
+            opt.variants = splitList(argv[++i]);
+        } else if (arg == "--scale" && hasValue) {
+            opt.scale = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--div" && hasValue) {
+            opt.divergence = std::strtof(argv[++i], nullptr);
+        } else if (arg == "--tol" && hasValue) {
+            opt.tol = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--max-diff" && hasValue) {
+            opt.maxDiffPercent = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--min-psnr" && hasValue) {
+            opt.minPsnr = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--key-bits" && hasValue) {
+            for (const std::string &item : splitList(argv[++i])) {
+                int bits = std::atoi(item.c_str());
+                if (bits < 8 || bits > 16) {
+                    std::cerr << "Depth bits must be in 8..16: " << item << std::endl;
+                    return false;
+                }
+                opt.keyBits.push_back(bits);
+            }
+        } else if (arg == "--batch" && hasValue) {
+            opt.batch = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--golden-only") {
+            opt.goldenOnly = true;
+        } else if (arg == "--update-golden") {
+            opt.update = true;
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            printUsage();
+            return false;
+        }
+    }
+    if (opt.golden.empty()) opt.golden = opt.root + "/regress/golden";
+    return true;
+}
+
+static bool selected(const std::vector<std::string> &list, const char *name) {
+    return list.empty() || std::find(list.begin(), list.end(), name) != list.end();
+}
+
+// 一个语料条目：缩小后的分离输入，以及按 8 位深度打包的 SBS（SplitPass / SplitGather 的输入）
+struct EntryInput {
+    const char *name = "";
+    RGBDImage img;
+    std::vector<uint8_t> sbs;
+    int width() const { return img.width; }
+    int height() const { return img.height; }
+    size_t pixels() const { return size_t(img.width) * img.height; }
+};
+
+// 两眼读回的 RGB
+struct EyeImages {
+    std::vector<uint8_t> eye[2];
+};
+
+// 检查计数：每项检查输出一行 PASS / FAIL
+struct CheckCounter {
+    int checked = 0, failures = 0;
+
+    void report(bool pass, const std::string &what) {
+        std::cout << "  " << (pass ? "PASS " : "FAIL ") << what << std::endl;
+        ++checked;
+        if (!pass) ++failures;
+    }
+    // 两眼须逐位一致
+    void expectEqual(const EyeImages &actual, const EyeImages &expected, size_t pixels, const std::string &what,
+                     const std::string &reference) {
+        for (int eye = 0; eye < 2; ++eye) {
+            DiffStats st = compareRGB(actual.eye[eye].data(), expected.eye[eye].data(), pixels, 0);
+            report(st.maxDelta == 0,
+                   what + (eye ? " right" : " left") + " vs " + reference + ": " + formatStats(st));
+        }
+    }
+};
+
+static bool loadVariant(StereoPipeline &pipeline, const RegressVariant &v, const std::string &root,
+                        const std::string &what) {
+    std::string dir = *v.shaderDir ? root + "/" + v.shaderDir : root;
+    if (pipeline.loadPrograms(v.warp, v.fill, dir, v.dialect, v.color)) return true;
+    std::cerr << "Shader compilation failed for " << what << v.name << std::endl;
+    return false;
+}
+
+// 只差一个开关的两份流水线（on 为被测的一份），输出须逐位一致
+struct PipelinePair {
+    const RegressVariant *variant = nullptr;
+    StereoPipeline on, off;
+
+    bool load(const std::string &root, const std::string &what) {
+        return loadVariant(on, *variant, root, what) && loadVariant(off, *variant, root, what);
+    }
+    void release() {
+        on.release();
+        off.release();
+    }
+};
+
+// 以给定的源纹理跑一帧（两眼 warp + fill）并读回
+static EyeImages runFrame(StereoPipeline &pipeline, const StereoParams &params, GLuint colorTex, GLuint depthTex,
+                          int w, int h) {
+    pipeline.setParams(params);
+    pipeline.allocateTargets(w, h);
+    pipeline.setSource(colorTex, depthTex);
+    pipeline.warp();
+    pipeline.fill();
+    EyeImages out;
+    out.eye[0] = readRGB(pipeline.left.color, w, h);
+    out.eye[1] = readRGB(pipeline.right.color, w, h);
+    return out;
+}
+
+// 按变体上传语料（SplitPass / SplitGather 为 SBS，其余为分离的颜色 + 深度）跑一帧
+static EyeImages runEntry(StereoPipeline &pipeline, const RegressVariant &v, const EntryInput &in,
+                          const StereoParams &params) {
+    const int w = in.width(), h = in.height();
+    GLuint colorTex = 0, depthTex = 0;
+    if (v.warp == WarpVariant::SplitPass || v.warp == WarpVariant::SplitGather) {
+        colorTex = createColorTexture(in.sbs.data(), w * 2, h);
+    } else {
+        colorTex = createColorTexture(in.img.rgb.data(), w, h);
+        depthTex = createDepthTexture(in.img.depth.data(), w, h);
+    }
+    EyeImages out = runFrame(pipeline, params, colorTex, depthTex, w, h);
+    glDeleteTextures(1, &colorTex);
+    if (depthTex) glDeleteTextures(1, &depthTex);
+    return out;
+}
+
+// 与 golden 比较（--update-golden 时改为写入 golden），返回输出供变体间一致性报告
+static EyeImages checkGolden(StereoPipeline &pipeline, const RegressVariant &v, const EntryInput &in,
+                             const StereoParams &params, const RegressOptions &opt, CheckCounter &counter,
+                             int &updated) {
+    const int w = in.width(), h = in.height();
+    EyeImages out = runEntry(pipeline, v, in, params);
+    const char *eyeNames[2] = {"left", "right"};
+    for (int eye = 0; eye < 2; ++eye) {
+        const std::vector<uint8_t> &actual = out.eye[eye];
+        std::string file = std::string(in.name) + "." + v.name + "." + eyeNames[eye] + ".png";
+        std::string goldenPath = opt.golden + "/" + file;
+
+        if (opt.update) {
+            stbi_write_png(goldenPath.c_str(), w, h, 3, actual.data(), w * 3);
+            ++updated;
+            continue;
+        }
+        int gw, gh, gn;
+        uint8_t *golden = stbi_load(goldenPath.c_str(), &gw, &gh, &gn, 3);
+        bool pass = false;
+        std::string detail;
+        if (!golden) {
+            detail = "missing golden " + goldenPath;
+        } else if (gw != w || gh != h) {
+            detail = "golden size " + std::to_string(gw) + "x" + std::to_string(gh);
+        } else {
+            DiffStats st = compareRGB(actual.data(), golden, in.pixels(), opt.tol);
+            pass = st.diffPercent <= opt.maxDiffPercent && st.psnr >= opt.minPsnr;
+            detail = formatStats(st);
+        }
+        if (golden) stbi_image_free(golden);
+
+        counter.report(pass, std::string(v.name) + " " + eyeNames[eye] + ": " + detail);
+        if (!pass) {
+            std::string actualPath = opt.out + "/" + file;
+            if (stbi_write_png(actualPath.c_str(), w, h, 3, actual.data(), w * 3))
+                std::cout << "       actual written to " << actualPath << std::endl;
+        }
+    }
+    return out;
+}
+
+// 竞争键精度报告：源为保留原始深度精度的 float SBS，原子次数 / 抬高次数按每个目标像素（两眼合计）归一，
+// 深度相等落败按候选计，输出与列表中最后一个（通常最精细的）位数比较
+static void reportKeyBits(std::vector<StereoPipeline> &pipelines, const std::vector<int> &bits, const EntryInput &in,
+                          const StereoParams &params, int tol) {
+    const int w = in.width(), h = in.height();
+    std::vector<EyeImages> outputs;
+    for (size_t ki = 0; ki < pipelines.size(); ++ki) {
+        GLuint colorTex = createFloatSBSTexture(in.img);
+        outputs.push_back(runFrame(pipelines[ki], params, colorTex, 0, w, h));
+        glDeleteTextures(1, &colorTex);
+        KeyStats ks;
+        pipelines[ki].readKeyStats(ks);
+
+        double px = double(in.pixels());
+        std::cout << "  keys d" << bits[ki] << ": " << std::fixed << std::setprecision(3) << ks.atomics / px
+                  << " atomics/px, " << ks.raises / px << " raises/px, tie losses " << std::setprecision(2)
+                  << 100.0 * ks.tieLosses / std::max<uint32_t>(ks.atomics, 1) << "% of atomics" << std::defaultfloat
+                  << std::endl;
+    }
+    for (size_t ki = 0; ki + 1 < pipelines.size(); ++ki) {
+        for (int eye = 0; eye < 2; ++eye) {
+            DiffStats st = compareRGB(outputs[ki].eye[eye].data(), outputs.back().eye[eye].data(), in.pixels(), tol);
+            std::cout << "  agree keys d" << bits[ki] << " vs d" << bits.back() << " " << (eye ? "right" : "left")
+                      << ": " << formatStats(st) << std::endl;
+        }
+    }
+}
+
+// fill 传播上限（on 有界、off 无界，均开启 FILL_STATS）：报告每帧（两眼）barrier 次数，有界输出须与无界逐位一致
+static void checkFillBound(PipelinePair &pair, const EntryInput &in, const StereoParams &params,
+                           CheckCounter &counter) {
+    const RegressVariant &v = *pair.variant;
+    FillStats bounded, unbounded;
+    EyeImages boundedOut = runEntry(pair.on, v, in, params);
+    pair.on.readFillStats(bounded);
+    EyeImages unboundedOut = runEntry(pair.off, v, in, params);
+    pair.off.readFillStats(unbounded);
+
+    const char *fillName = variantName(v.fill);
+    std::cout << "  fill " << fillName << ": " << bounded.barriers << " barriers/frame bounded vs "
+              << unbounded.barriers << " unbounded (" << std::fixed << std::setprecision(1)
+              << 100.0 * (1.0 - double(bounded.barriers) / std::max<uint32_t>(unbounded.barriers, 1))
+              << "% saved), " << bounded.fallbacks << " fallback passes in " << bounded.workgroups << " workgroups"
+              << std::defaultfloat << std::endl;
+    counter.expectEqual(boundedOut, unboundedOut, in.pixels(), std::string("fill bound ") + fillName, "unbounded");
+}
+
+// 共用视差（on 开启）：输出须与各眼自行解码深度逐位一致，另报告每帧 barrier 次数
+static void checkSharedDisparity(PipelinePair &pair, const EntryInput &in, const StereoParams &params,
+                                 CheckCounter &counter) {
+    const RegressVariant &v = *pair.variant;
+    EyeImages shared = runEntry(pair.on, v, in, params);
+    EyeImages perEye = runEntry(pair.off, v, in, params);
+    std::cout << "  shared disparity " << v.name << ": " << pair.on.barriersPerFrame() << " barriers/frame vs "
+              << pair.off.barriersPerFrame() << std::endl;
+    counter.expectEqual(shared, perEye, in.pixels(), std::string("shared disparity ") + v.name, "per eye");
+}
+
+// 深度归一化的一种情形：pair.on 在 GPU 上归一化，pair.off 不归一化、输入按读回的参数在 CPU 上归一化
+struct NormCase {
+    DepthNormalize mode = DepthNormalize::None;
+    bool sharedDisp = false;
+    PipelinePair pair;
+};
+
+// 深度换算成米制量级（0.5 + 40d，无数据仍为 0），不归一化时几乎所有像素都超出 [0,1]。
+// GPU 统计的 min / max 须与 CPU 相同，百分位与 CPU 排序结果相差不超过一段直方图；
+// 输出须与按读回的参数在 CPU 上归一化后的输入逐位一致，调试灰度图同样逐像素比较
+static void checkDepthNorm(std::vector<NormCase> &normCases, const EntryInput &in, const StereoParams &params,
+                           CheckCounter &counter) {
+    const RGBDImage &img = in.img;
+    const int w = in.width(), h = in.height();
+    std::vector<float> metric(img.depth.size()), valid;
+    for (size_t i = 0; i < metric.size(); ++i) {
+        metric[i] = img.depth[i] > 0.0f ? 0.5f + 40.0f * img.depth[i] : 0.0f;
+        if (metric[i] > 0.0f) valid.push_back(metric[i]);
+    }
+    std::sort(valid.begin(), valid.end());
+    size_t above = size_t(std::count_if(metric.begin(), metric.end(), [](float z) { return z > 1.0f; }));
+    std::cout << "  depth norm: metric depth " << std::fixed << std::setprecision(1)
+              << (valid.empty() ? 0.0f : valid.front()) << ".." << (valid.empty() ? 0.0f : valid.back()) << ", "
+              << 100.0 * double(above) / double(metric.size()) << "% px beyond 1 without normalization" << std::endl;
+
+    GLuint colorTex = createColorTexture(img.rgb.data(), w, h);
+    GLuint metricTex = createDepthTexture(metric.data(), w, h);
+    for (size_t ci = 0; ci < normCases.size(); ++ci) {
+        NormCase &c = normCases[ci];
+        std::string name = std::string(c.pair.variant->name) + " " + variantName(c.mode);
+        if (c.sharedDisp) name += " shared disparity";
+        StereoPipeline &normalized = c.pair.on;
+        StereoPipeline &reference = c.pair.off;
+        EyeImages eyes = runFrame(normalized, params, colorTex, metricTex, w, h);
+        DepthRange range;
+        normalized.readDepthRange(range);
+
+        // 与着色器的 loadDepth 相同
+        std::vector<float> cpuDepth(metric.size());
+        for (size_t i = 0; i < metric.size(); ++i) {
+            float z = metric[i];
+            cpuDepth[i] = z > 0.0f && !std::isinf(z)
+                              ? std::min(std::max((z - range.normLo) * range.normScale, 0.0f), 1.0f)
+                              : 0.0f;
+        }
+        GLuint normTex = createDepthTexture(cpuDepth.data(), w, h);
+        EyeImages refEyes = runFrame(reference, params, colorTex, normTex, w, h);
+        glDeleteTextures(1, &normTex);
+        std::cout << "  depth norm " << name << ": range " << std::setprecision(3) << range.lo << ".." << range.hi
+                  << ", " << normalized.barriersPerFrame() << " barriers/frame vs " << reference.barriersPerFrame()
+                  << std::endl;
+
+        // 范围只需对每种模式检查一次
+        if (ci < 2) {
+            float minD = valid.empty() ? 0.0f : valid.front(), maxD = valid.empty() ? 0.0f : valid.back();
+            bool pass = range.min == minD && range.max == maxD;
+            if (c.mode == DepthNormalize::MinMax) {
+                pass = pass && range.lo == minD && range.hi == maxD;
+            } else if (!valid.empty()) {
+                // 与 depth_range.comp 相同的名次：lo 为第 floor(N*1%) 个，hi 为第 floor(N*99%) 个
+                float bin = (maxD - minD) / 1024.0f * 1.001f;
+                float pLo = valid[size_t(float(valid.size()) * 0.01f)];
+                float pHi = valid[std::min(size_t(float(valid.size()) * 0.99f), valid.size() - 1)];
+                pass = pass && std::fabs(range.lo - pLo) <= bin && std::fabs(range.hi - pHi) <= bin;
+            }
+            counter.report(pass, "depth norm " + name + " range vs CPU");
+        }
+        counter.expectEqual(eyes, refEyes, in.pixels(), "depth norm " + name, "CPU-normalized");
+        if (ci == 0) {
+            std::vector<uint8_t> gray;
+            size_t mismatches = normalized.readDepthPreview(gray) ? 0 : cpuDepth.size();
+            for (size_t i = 0; i < gray.size() && i < cpuDepth.size(); ++i)
+                if (gray[i] != uint8_t(cpuDepth[i] * 255.0f + 0.5f)) ++mismatches;
+            counter.report(mismatches == 0, "depth norm preview vs CPU: " + std::to_string(mismatches) + " px differ");
+        }
+    }
+    glDeleteTextures(1, &colorTex);
+    glDeleteTextures(1, &metricTex);
+}
+
+// 输出打包：GPU 打包结果须与 CPU 按同一公式打包 RGBA 读回逐字节一致；奇数尺寸的裁剪检查色度平面的边缘块
+static void checkOutputFormats(StereoPipeline &pipeline, const EntryInput &in, const StereoParams &params,
+                               CheckCounter &counter) {
+    const RGBDImage &img = in.img;
+    const int w = in.width(), h = in.height();
+    int cropW = w - (w % 2 == 0), cropH = h - (h % 2 == 0);
+    for (int crop = 0; crop < 2; ++crop) {
+        int pw = crop ? cropW : w, ph = crop ? cropH : h;
+        std::vector<uint8_t> rgb(size_t(pw) * ph * 3);
+        std::vector<float> depth(size_t(pw) * ph);
+        for (int y = 0; y < ph; ++y) {
+            std::copy_n(&img.rgb[size_t(y) * w * 3], size_t(pw) * 3, &rgb[size_t(y) * pw * 3]);
+            std::copy_n(&img.depth[size_t(y) * w], size_t(pw), &depth[size_t(y) * pw]);
+        }
+        GLuint colorTex = createColorTexture(rgb.data(), pw, ph);
+        GLuint depthTex = createDepthTexture(depth.data(), pw, ph);
+        pipeline.setParams(params);
+        pipeline.allocateTargets(pw, ph);
+        pipeline.setSource(colorTex, depthTex);
+        for (OutputFormat format : {OutputFormat::RGB, OutputFormat::BGRA, OutputFormat::NV12, OutputFormat::I420}) {
+            std::string name =
+                std::string("output ") + variantName(format) + " " + std::to_string(pw) + "x" + std::to_string(ph);
+            if (!pipeline.setOutputFormat(format)) {
+                counter.report(false, name + ": shader compilation failed");
+                continue;
+            }
+            pipeline.warp();
+            pipeline.fill();
+            size_t bytes = outputBytes(format, pw, ph);
+            std::vector<uint8_t> packed[2] = {std::vector<uint8_t>(bytes), std::vector<uint8_t>(bytes)};
+            pipeline.readOutput(packed[0].data(), packed[1].data());
+            GLuint eyeTex[2] = {pipeline.left.color, pipeline.right.color};
+            for (int eye = 0; eye < 2; ++eye) {
+                std::vector<uint8_t> expected = packOutputCPU(readRGBA(eyeTex[eye], pw, ph), pw, ph, format);
+                size_t mismatches = 0;
+                for (size_t i = 0; i < bytes; ++i)
+                    if (packed[eye][i] != expected[i]) ++mismatches;
+                std::ostringstream what;
+                what << name << " " << (eye ? "right" : "left") << " vs CPU: " << mismatches << " bytes differ, "
+                     << bytes << " B (" << std::fixed << std::setprecision(1)
+                     << 100.0 * double(bytes) / double(outputBytes(OutputFormat::RGBA, pw, ph)) << "% of RGBA), "
+                     << pipeline.barriersPerFrame() << " barriers/frame";
+                counter.report(mismatches == 0, what.str());
+            }
+        }
+        pipeline.setOutputFormat(OutputFormat::RGBA);
+        glDeleteTextures(1, &colorTex);
+        glDeleteTextures(1, &depthTex);
+    }
+}
+
+// 多帧批处理：第 i 帧视差为 div * (1 + 0.5i)、奇数帧汇聚 0.5，每层须与逐帧处理逐位一致
+static void checkBatch(FrameBatch &batch, StereoPipeline &reference, int frames, const EntryInput &in,
+                       float divergence, CheckCounter &counter) {
+    const int w = in.width(), h = in.height();
+    if (!batch.allocate(w, h, frames)) return;
+    std::vector<StereoParams> frameParams(frames);
+    for (int f = 0; f < frames; ++f) {
+        frameParams[size_t(f)].divergence = divergence * (1.0f + 0.5f * f);
+        frameParams[size_t(f)].convergence = f % 2 ? 0.5f : 0.0f;
+        batch.upload(f, in.img.rgb.data(), in.img.depth.data());
+        batch.setParams(f, frameParams[size_t(f)]);
+    }
+    batch.run();
+    std::cout << "  batch " << frames << " frames: " << batch.barriersPerBatch() << " barriers/batch" << std::endl;
+
+    GLuint colorTex = createColorTexture(in.img.rgb.data(), w, h);
+    GLuint depthTex = createDepthTexture(in.img.depth.data(), w, h);
+    EyeImages layers;
+    for (int f = 0; f < frames; ++f) {
+        for (int eye = 0; eye < 2; ++eye) {
+            layers.eye[eye].resize(in.pixels() * 3);
+            batch.readEye(f, eye ? -1 : 1, layers.eye[eye].data());
+        }
+        EyeImages single = runFrame(reference, frameParams[size_t(f)], colorTex, depthTex, w, h);
+        counter.expectEqual(layers, single, in.pixels(), "batch frame " + std::to_string(f), "single");
+    }
+    glDeleteTextures(1, &colorTex);
+    glDeleteTextures(1, &depthTex);
+}
+
+// 流式处理：可流式的变体经 StripeStreamer 按行条带（37 行，不整除语料高度，末条不满）与 256 列分块处理，
+// 须与整幅逐位一致；延迟取色跨块只传索引，只按条带处理，列分块与不可流式的变体（Mesh、SplitPass 系列）须被拒绝。
+// 语料右侧拼上自身的镜像：缩小后的宽度不到两个 halo，不加宽时每块的起点都是第 0 列
+static void checkStreaming(std::vector<StereoPipeline> &pipelines, const EntryInput &in, const StereoParams &params,
+                           CheckCounter &counter) {
+    const int w = in.width() * 2, h = in.height();
+    const int rows = 37, tileCols = StereoPipeline::TILE_W;
+    const size_t pixels = size_t(w) * h;
+    std::vector<uint8_t> rgb(pixels * 3);
+    std::vector<float> depth(pixels);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            int sx = x < in.width() ? x : w - 1 - x;
+            size_t src = size_t(y) * in.width() + sx, dst = size_t(y) * w + x;
+            std::copy_n(&in.img.rgb[src * 3], 3, &rgb[dst * 3]);
+            depth[dst] = in.img.depth[src];
+        }
+    }
+    GLuint colorTex = createColorTexture(rgb.data(), w, h);
+    GLuint depthTex = createDepthTexture(depth.data(), w, h);
+    for (size_t i = 0; i < pipelines.size(); ++i) {
+        StereoPipeline &pipeline = pipelines[i];
+        std::string name = std::string("streaming ") + kVariants[i].name;
+        StripeStreamer streamer;
+        pipeline.setParams(params);
+        if (!pipeline.streamable()) {
+            counter.report(!streamer.begin(pipeline, w, rows, tileCols), name + " refused");
+            continue;
+        }
+        EyeImages whole = runFrame(pipeline, params, colorTex, depthTex, w, h);
+        int cols = pipeline.columnTileable() ? tileCols : 0;
+        if (!cols) counter.report(!streamer.begin(pipeline, w, rows, tileCols), name + " column tiles refused");
+        if (!streamer.begin(pipeline, w, rows, cols)) {
+            counter.report(false, name + ": streamer refused the pipeline");
+            continue;
+        }
+        EyeImages streamed;
+        for (std::vector<uint8_t> &eye : streamed.eye)
+            eye.resize(pixels * 3);
+        streamer.run(rgb.data(), depth.data(), h, streamed.eye[0].data(), streamed.eye[1].data());
+        streamer.release();
+        std::string blocks = std::to_string(w) + "x" + std::to_string(h) + " in " + std::to_string(rows) + "-row stripes";
+        if (cols) blocks += ", " + std::to_string(cols) + "-column tiles";
+        counter.expectEqual(streamed, whole, pixels, name + " " + blocks, "whole image");
+    }
+    glDeleteTextures(1, &colorTex);
+    glDeleteTextures(1, &depthTex);
+}
+
+int main(int argc, char **argv) {
+    RegressOptions opt;
+    if (!parseOptions(argc, argv, opt)) {
+        return -1;
+    }
+
+    traceInit();
+    if (!createOffscreenContext(false)) {
+        return -1;
+    }
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+    // 变体着色器只编译一次
+    std::vector<const RegressVariant *> variants;
+    std::vector<StereoPipeline> pipelines;
+    for (const RegressVariant &v : kVariants) {
+        if (selected(opt.variants, v.name)) variants.push_back(&v);
+    }
+    pipelines.resize(variants.size());
+    for (size_t i = 0; i < variants.size(); ++i) {
+        if (!loadVariant(pipelines[i], *variants[i], opt.root, "")) return -1;
+    }
+
+    // 竞争键精度：同一 split+log_shift 着色器按不同 DEPTH_BITS 编译，开启 KEY_STATS
+    std::vector<StereoPipeline> keyPipelines(opt.keyBits.size());
+    for (size_t i = 0; i < opt.keyBits.size(); ++i) {
+        if (!keyPipelines[i].setDepthBits(opt.keyBits[i], true) ||
+            !keyPipelines[i].loadPrograms(WarpVariant::SplitPass, FillVariant::LogShift,
+                                          opt.root + "/OpenGLStereoGenerator/shaders")) {
+            std::cerr << "Shader compilation failed for depth bits " << opt.keyBits[i] << std::endl;
+            return -1;
+        }
+    }
+
+    // 逐位一致检查：fill 传播上限与共用视差，scatter+tile_prefix / split+log_shift 各编译开关两份
+    PipelinePair fillPairs[2], dispPairs[2];
+    // 输出打包：scatter+tile_prefix 依次切换读回格式；多帧批处理：与逐帧的 scatter+tile_prefix 比较
+    StereoPipeline packPipeline;
+    FrameBatch batch;
+    StereoPipeline batchReference;
+    // 流式处理：每个变体一份，可流式的读回格式为 StripeStreamer 要求的 RGB
+    std::vector<StereoPipeline> streamPipelines(opt.goldenOnly ? 0 : std::size(kVariants));
+    for (size_t i = 0; i < streamPipelines.size(); ++i) {
+        StereoPipeline &pipeline = streamPipelines[i];
+        if (!loadVariant(pipeline, kVariants[i], opt.root, "streaming ")) return -1;
+        if (pipeline.streamable() && !pipeline.setOutputFormat(OutputFormat::RGB, opt.root)) {
+            std::cerr << "Shader compilation failed for streaming " << kVariants[i].name << " output" << std::endl;
+            return -1;
+        }
+    }
+    if (!opt.goldenOnly) {
+        for (int i = 0; i < 2; ++i) {
+            fillPairs[i].variant = dispPairs[i].variant = &kVariants[i];
+            fillPairs[i].on.setFillBound(true, true);
+            fillPairs[i].off.setFillBound(false, true);
+            dispPairs[i].on.setSharedDisparity(true, opt.root);
+            if (!fillPairs[i].load(opt.root, "fill bound ") || !dispPairs[i].load(opt.root, "shared disparity "))
+                return -1;
+        }
+        if (!loadVariant(packPipeline, kVariants[0], opt.root, "output packing ")) return -1;
+        if (opt.batch > 0 && !batch.loadPrograms(opt.root)) {
+            std::cerr << "Shader compilation failed for batch" << std::endl;
+            return -1;
+        }
+        if (opt.batch > 0 && !loadVariant(batchReference, kVariants[0], opt.root, "batch ")) return -1;
+    }
+
+    // 深度归一化：根目录着色器的各 warp / 取色方式测 MinMax（前两种情形的范围另与 CPU 比较），
+    // scatter+tile_prefix 另测 Percentile 与共用视差
+    const struct {
+        int variant;
+        DepthNormalize mode;
+        bool sharedDisp;
+    } normSpecs[] = {
+        {0, DepthNormalize::MinMax, false}, {0, DepthNormalize::Percentile, false}, {0, DepthNormalize::MinMax, true},
+        {4, DepthNormalize::MinMax, false}, {5, DepthNormalize::MinMax, false},     {6, DepthNormalize::MinMax, false},
+        {8, DepthNormalize::MinMax, false}, {9, DepthNormalize::MinMax, false},
+    };
+    std::vector<NormCase> normCases(opt.goldenOnly ? 0 : std::size(normSpecs));
+    for (size_t i = 0; i < normCases.size(); ++i) {
+        NormCase &c = normCases[i];
+        c.mode = normSpecs[i].mode;
+        c.sharedDisp = normSpecs[i].sharedDisp;
+        c.pair.variant = &kVariants[normSpecs[i].variant];
+        c.pair.on.setDepthNormalize(c.mode);
+        c.pair.on.setSharedDisparity(c.sharedDisp);
+        c.pair.off.setSharedDisparity(c.sharedDisp);
+        if (!c.pair.load(opt.root, "depth normalization ")) return -1;
+    }
+
+    StereoParams params;
+    params.divergence = opt.divergence;
+
+    std::error_code ec;
+    std::filesystem::create_directories(opt.update ? opt.golden : opt.out, ec);
+
+    CheckCounter counter;
+    int updated = 0;
+    for (const CorpusEntry &entry : corpus()) {
+        if (!selected(opt.entries, entry.name)) continue;
+
+        RGBDImage full;
+        if (!entry.load(opt.root, full)) {
+            std::cerr << entry.name << ": failed to load corpus input" << std::endl;
+            ++counter.failures;
+            continue;
+        }
+        EntryInput in;
+        in.name = entry.name;
+        in.img = downscale(full, opt.scale);
+        in.sbs = packSideBySide(in.img);
+        const int w = in.width(), h = in.height();
+        std::cout << "== " << entry.name << " " << w << "x" << h << std::endl;
+
+        // 各变体的输出，用于变体间一致性报告
+        std::vector<EyeImages> outputs;
+        for (size_t vi = 0; vi < variants.size(); ++vi)
+            outputs.push_back(checkGolden(pipelines[vi], *variants[vi], in, params, opt, counter, updated));
+
+        // 变体间一致性：仅报告，不计入失败（各填充算法本就不同）
+        for (size_t vi = 1; vi < variants.size(); ++vi) {
+            for (int eye = 0; eye < 2; ++eye) {
+                DiffStats st = compareRGB(outputs[vi].eye[eye].data(), outputs[0].eye[eye].data(), in.pixels(), opt.tol);
+                std::cout << "  agree " << variants[vi]->name << " vs " << variants[0]->name << " "
+                          << (eye ? "right" : "left") << ": " << formatStats(st) << std::endl;
+            }
+        }
+
+        reportKeyBits(keyPipelines, opt.keyBits, in, params, opt.tol);
+        if (!opt.goldenOnly) {
+            for (PipelinePair &pair : fillPairs) checkFillBound(pair, in, params, counter);
+            for (PipelinePair &pair : dispPairs) checkSharedDisparity(pair, in, params, counter);
+        }
+        if (!normCases.empty()) checkDepthNorm(normCases, in, params, counter);
+        if (!opt.goldenOnly) {
+            checkOutputFormats(packPipeline, in, params, counter);
+            if (opt.batch > 0) checkBatch(batch, batchReference, opt.batch, in, opt.divergence, counter);
+            checkStreaming(streamPipelines, in, params, counter);
+        }
+
+        // 仓库里的 xptest/*_eye_filled.png 是全分辨率的历史输出，只在 --scale 1 时对照
+        if (opt.scale == 1 && std::string(entry.name) == "image_exr" && variants[0]->warp == WarpVariant::Scatter) {
+            const char *xp[2] = {"/xptest/left_eye_filled.png", "/xptest/right_eye_filled.png"};
+            for (int eye = 0; eye < 2; ++eye) {
+                int xw, xh, xn;
+                uint8_t *ref = stbi_load((opt.root + xp[eye]).c_str(), &xw, &xh, &xn, 3);
+                if (!ref) continue;
+                if (xw == w && xh == h) {
+                    DiffStats st = compareRGB(outputs[0].eye[eye].data(), ref, in.pixels(), opt.tol);
+                    std::cout << "  agree " << variants[0]->name << " vs xptest " << (eye ? "right" : "left") << ": "
+                              << formatStats(st) << std::endl;
+                }
+                stbi_image_free(ref);
+            }
+        }
+    }
+
+    for (StereoPipeline &pipeline : pipelines)
+        pipeline.release();
+    for (StereoPipeline &pipeline : keyPipelines)
+        pipeline.release();
+    for (PipelinePair &pair : fillPairs)
+        pair.release();
+    for (PipelinePair &pair : dispPairs)
+        pair.release();
+    for (NormCase &c : normCases)
+        c.pair.release();
+    packPipeline.release();
+    for (StereoPipeline &pipeline : streamPipelines)
+        pipeline.release();
+    batch.release();
+    batchReference.release();
+    traceShutdown();
+    glfwTerminate();
+
+    if (opt.update) {
+        std::cout << "Updated " << updated << " golden images in " << opt.golden << std::endl;
+        return counter.failures ? 1 : 0;
+    }
+    std::cout << counter.checked << " checks, " << counter.failures << " failures" << std::endl;
+    return counter.failures ? 1 : 0;
+}
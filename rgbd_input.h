@@ -0,0 +1,46 @@
+#pragma once
+// RGB-D 输入层：分离的颜色 PNG + EXR 深度，或颜色与深度打包在同一张 PNG（左右 / 上下 / Alpha）
+// 打包输入只解码、上传一次，warp.comp 按 depthOffset / depthEncoding 直接从同一纹理读深度
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+
+enum class InputLayout {
+    Separate,   // image.png + depth.exr
+    SideBySide, // 左半颜色，右半深度（android_gles / OpenGLStereoGenerator 的 SBS 素材）
+    TopBottom,  // 上半颜色，下半深度
+    ColorAlpha, // RGB 颜色 + A 通道深度（rgb_depth.png）
+};
+
+// 取值与 warp.comp 的 depthEncoding 一致；8 位编码都按字节整数重组，结果与 CPU 的 c/255 逐位一致
+enum class DepthEncoding {
+    Float = 0, // R32F 深度纹理，原样读取 R
+    R8 = 1,    // R 通道 8 位（sbs_depth.png）
+    RG16 = 2,  // R 高 8 位、G 低 8 位（sbs_depthrg.png）
+    RGB24 = 3, // R 高、G 中、B 低（sbs_depthrgb.png）
+    A8 = 4,    // A 通道 8 位（rgb_depth.png）
+};
+
+struct RGBDInput {
+    GLuint colorTex = 0;         // 颜色从 (0,0) 起
+    GLuint depthTex = 0;         // 打包布局下与 colorTex 相同
+    int width = 0, height = 0;   // 单幅（颜色）尺寸
+    int depthOffsetX = 0, depthOffsetY = 0;
+    DepthEncoding encoding = DepthEncoding::Float;
+    InputLayout layout = InputLayout::Separate;
+
+    void release();
+};
+
+bool parseInputLayout(const std::string &name, InputLayout &layout);
+bool parseDepthEncoding(const std::string &name, DepthEncoding &encoding);
+
+bool loadSeparateRGBD(const char *colorPath, const char *depthPath, RGBDInput &input);
+bool loadPackedRGBD(const char *path, InputLayout layout, DepthEncoding encoding, RGBDInput &input);
+
+// 从内存创建（行紧密排列）：打包图像 width x height 为整幅尺寸；分离输入为 RGB/RGBA + float 深度
+bool createPackedRGBD(const uint8_t *pixels, int width, int height, int channels, InputLayout layout,
+                      DepthEncoding encoding, RGBDInput &input);
+bool createSeparateRGBD(const uint8_t *pixels, int channels, const float *depth, int width, int height,
+                        RGBDInput &input);
@@ -0,0 +1,88 @@
+#include "shared_memory.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SharedMemory::~SharedMemory() {
+    close();
+}
+
+bool SharedMemory::create(const std::string &name, size_t size) {
+    close();
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+        std::cerr << "shm_open(" << name << ") failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (ftruncate(fd, off_t(size)) != 0) {
+        std::cerr << "ftruncate(" << name << ") failed: " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    bool ok = map(fd, size, 0, true);
+    ::close(fd);
+    if (ok) name_ = name;
+    return ok;
+}
+
+bool SharedMemory::open(const std::string &name, size_t size, bool writable) {
+    close();
+    int fd = shm_open(name.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+    if (fd < 0) {
+        std::cerr << "shm_open(" << name << ") failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (size == 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0) size = size_t(st.st_size);
+    }
+    bool ok = map(fd, size, 0, writable);
+    ::close(fd);
+    if (ok) name_ = name;
+    return ok;
+}
+
+bool SharedMemory::map(int fd, size_t size, size_t offset, bool writable) {
+    close();
+    if (size == 0) {
+        std::cerr << "Shared memory mapping of size 0" << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) < offset + size) {
+        std::cerr << "Shared memory too small: " << st.st_size << " < " << offset + size << std::endl;
+        return false;
+    }
+    // mmap 的偏移必须页对齐，多映射一段前缀
+    size_t page = size_t(sysconf(_SC_PAGESIZE));
+    size_t alignedOffset = offset / page * page;
+    size_t lead = offset - alignedOffset;
+    void *p = mmap(nullptr, size + lead, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd,
+                   off_t(alignedOffset));
+    if (p == MAP_FAILED) {
+        std::cerr << "mmap failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    base_ = static_cast<uint8_t *>(p);
+    data_ = base_ + lead;
+    mappedSize_ = size + lead;
+    size_ = size;
+    return true;
+}
+
+void SharedMemory::close() {
+    if (base_) munmap(base_, mappedSize_);
+    base_ = data_ = nullptr;
+    mappedSize_ = size_ = 0;
+    name_.clear();
+}
+
+void SharedMemory::unlink(const std::string &name) {
+    shm_unlink(name.c_str());
+}
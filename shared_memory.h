@@ -0,0 +1,35 @@
+#pragma once
+// POSIX 共享内存段（shm_open + mmap），用于进程间零拷贝交换帧数据（仅 UNIX）
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class SharedMemory {
+public:
+    SharedMemory() = default;
+    ~SharedMemory();
+    SharedMemory(const SharedMemory &) = delete;
+    SharedMemory &operator=(const SharedMemory &) = delete;
+
+    // 新建（已存在则截断）size 字节的段
+    bool create(const std::string &name, size_t size);
+    // 映射已存在的段，size 为 0 时取整段
+    bool open(const std::string &name, size_t size = 0, bool writable = false);
+    // 映射已有的文件描述符（memfd / shm fd），不接管 fd
+    bool map(int fd, size_t size, size_t offset = 0, bool writable = false);
+    void close();
+    // 删除名字；已映射的进程仍可继续访问
+    static void unlink(const std::string &name);
+
+    uint8_t *data() const { return data_; }
+    size_t size() const { return size_; }
+    const std::string &name() const { return name_; }
+
+private:
+    std::string name_;
+    uint8_t *data_ = nullptr;
+    uint8_t *base_ = nullptr; // mmap 返回的页对齐地址（offset 非页对齐时与 data_ 不同）
+    size_t mappedSize_ = 0;
+    size_t size_ = 0;
+};
@@ -0,0 +1,1054 @@
+#include "stereo_pipeline.h"
+#include "gl_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+static const int kRangeBins = 1024; // 与 depth_range.comp 的 RANGE_BINS 一致
+
+const char *variantName(WarpVariant warp) {
+    switch (warp) {
+    case WarpVariant::Scatter: return "scatter";
+    case WarpVariant::SplitPass: return "split";
+    case WarpVariant::Gather: return "gather";
+    case WarpVariant::SplitGather: return "split_gather";
+    case WarpVariant::RowScatter: return "row";
+    case WarpVariant::Mesh: return "mesh";
+    }
+    return "?";
+}
+
+const char *variantName(FillVariant fill) {
+    switch (fill) {
+    case FillVariant::TilePrefix: return "tile_prefix";
+    case FillVariant::LogShift: return "log_shift";
+    }
+    return "?";
+}
+
+const char *variantName(ColorResolve color) {
+    switch (color) {
+    case ColorResolve::Eager: return "eager";
+    case ColorResolve::Deferred: return "deferred";
+    case ColorResolve::DeferredBilinear: return "deferred_bilinear";
+    case ColorResolve::Splat: return "splat";
+    }
+    return "?";
+}
+
+const char *variantName(DepthNormalize norm) {
+    switch (norm) {
+    case DepthNormalize::None: return "none";
+    case DepthNormalize::MinMax: return "minmax";
+    case DepthNormalize::Percentile: return "percentile";
+    }
+    return "?";
+}
+
+const char *variantName(OutputFormat format) {
+    switch (format) {
+    case OutputFormat::RGBA: return "rgba";
+    case OutputFormat::RGB: return "rgb";
+    case OutputFormat::BGRA: return "bgra";
+    case OutputFormat::NV12: return "nv12";
+    case OutputFormat::I420: return "i420";
+    }
+    return "?";
+}
+
+bool parseColorResolve(const std::string &name, ColorResolve &color) {
+    for (ColorResolve c : {ColorResolve::Eager, ColorResolve::Deferred, ColorResolve::DeferredBilinear,
+                           ColorResolve::Splat}) {
+        if (name == variantName(c)) {
+            color = c;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseDepthNormalize(const std::string &name, DepthNormalize &norm) {
+    for (DepthNormalize n : {DepthNormalize::None, DepthNormalize::MinMax, DepthNormalize::Percentile}) {
+        if (name == variantName(n)) {
+            norm = n;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseOutputFormat(const std::string &name, OutputFormat &format) {
+    for (OutputFormat f : {OutputFormat::RGBA, OutputFormat::RGB, OutputFormat::BGRA, OutputFormat::NV12,
+                           OutputFormat::I420}) {
+        if (name == variantName(f)) {
+            format = f;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t outputBytes(OutputFormat format, int width, int height) {
+    size_t pixels = size_t(width) * height;
+    switch (format) {
+    case OutputFormat::RGBA:
+    case OutputFormat::BGRA: return pixels * 4;
+    case OutputFormat::RGB: return pixels * 3;
+    case OutputFormat::NV12:
+    case OutputFormat::I420: return pixels + size_t((width + 1) / 2) * ((height + 1) / 2) * 2;
+    }
+    return 0;
+}
+
+std::string StereoPipeline::depthDecodeSource(const std::string &shaderDir) {
+    return loadFile((shaderDir.empty() ? std::string("depth_decode.glsl") : shaderDir + "/depth_decode.glsl").c_str());
+}
+
+bool StereoPipeline::loadPrograms(WarpVariant warp, FillVariant fill, const std::string &shaderDir,
+                                  ShaderDialect dialect, ColorResolve color) {
+    warpVariant_ = warp;
+    fillVariant_ = fill;
+    colorResolve_ = color;
+    shaderDir_ = shaderDir;
+    auto path = [&](const char *name) { return shaderDir.empty() ? std::string(name) : shaderDir + "/" + name; };
+
+    if (color != ColorResolve::Eager && dialect != ShaderDialect::Desktop) {
+        std::cerr << "Deferred / splat color resolve needs desktop shaders" << std::endl;
+        return false;
+    }
+    if (color == ColorResolve::Splat && warp != WarpVariant::Scatter) {
+        std::cerr << "Splat color resolve only supports scatter warp" << std::endl;
+        return false;
+    }
+
+    if (fillStats_ && (warp == WarpVariant::Mesh || dialect != ShaderDialect::Desktop)) {
+        std::cerr << "Fill stats need a fill pass with desktop shaders" << std::endl;
+        return false;
+    }
+    if (keyStats_ && (warp != WarpVariant::SplitPass || dialect != ShaderDialect::Desktop)) {
+        std::cerr << "Key stats need split warp with desktop shaders" << std::endl;
+        return false;
+    }
+    // SplitPass 竞争键的编译期特化
+    std::string keyDefines = "#define DEPTH_BITS " + std::to_string(depthBits_) + "\n";
+    if (keyStats_) keyDefines += "#define KEY_STATS\n";
+    // 共用视差：warp 从预计算纹理取竞争键深度部分和视差
+    bool sharedDisp = sharedDisp_ && dialect == ShaderDialect::Desktop &&
+                      (warp == WarpVariant::Scatter || warp == WarpVariant::SplitPass);
+    const std::string dispDefines = sharedDisp ? "#define SHARED_DISP\n" : "";
+    // 深度归一化：读深度的着色器按 GPU 统计的范围映射深度（SBS 输入的变体只有 8 位深度，不需要）
+    normalizeDepth_ = depthNorm_ != DepthNormalize::None && dialect == ShaderDialect::Desktop &&
+                      warp != WarpVariant::SplitPass && warp != WarpVariant::SplitGather;
+    const std::string normDefines = normalizeDepth_ ? "#define DEPTH_NORM\n" : "";
+    if (normalizeDepth_ && !loadRangePrograms()) return false;
+    if (sharedDisp) {
+        std::string dir = dispShaderDir_.empty() ? shaderDir : dispShaderDir_;
+        dispProg_ = createComputeProgram((dir.empty() ? std::string("disparity.comp") : dir + "/disparity.comp").c_str(),
+                                         normDefines + depthDecodeSource(dir));
+        if (!dispProg_) return false;
+    }
+
+    if (dialect == ShaderDialect::GLES) {
+        if (warp != WarpVariant::SplitPass || fill != FillVariant::LogShift) {
+            std::cerr << "GLES shaders only provide split + log_shift" << std::endl;
+            return false;
+        }
+        auto load = [&](const char *name, const std::string &defines = "") {
+            return createComputeProgramFromSource(injectDefines(portESToDesktop(loadFile(path(name).c_str())), defines));
+        };
+        warpProg_ = load("warp_depth.comp", keyDefines);
+        resolveProg_ = load("warp_color.comp", keyDefines);
+        tileProg_ = load("fill_tile_es.comp");
+        return warpProg_ && resolveProg_ && tileProg_;
+    }
+
+    // 根目录读深度的着色器（warp / warp_splat / warp_gather / warp_row / warp_mesh.vert / gather_color）共用一份解码
+    const std::string depthDefines = normDefines + depthDecodeSource(shaderDir);
+    if (color == ColorResolve::Splat) {
+        warpProg_ = createComputeProgram(path("warp.comp").c_str(), dispDefines + depthDefines);
+        splatProg_ = createComputeProgram(path("warp_splat.comp").c_str(), depthDefines);
+        resolveProg_ = createComputeProgram(path("splat_normalize.comp").c_str());
+        if (!splatProg_) return false;
+    } else if (warp == WarpVariant::Scatter) {
+        warpProg_ = createComputeProgram(path("warp.comp").c_str(), dispDefines + depthDefines);
+        resolveProg_ = createComputeProgram(path("warp_resolve.comp").c_str());
+    } else if (warp == WarpVariant::Gather) {
+        warpProg_ = createComputeProgram(path("warp_gather.comp").c_str(), depthDefines);
+    } else if (warp == WarpVariant::RowScatter) {
+        warpProg_ = createComputeProgram(path("warp_row.comp").c_str(), depthDefines);
+    } else if (warp == WarpVariant::SplitGather) {
+        warpProg_ = createComputeProgram(path("warp_gather_gl.comp").c_str(), keyDefines);
+    } else if (warp == WarpVariant::Mesh) {
+        warpProg_ = createShaderProgram(path("warp_mesh.vert").c_str(), path("warp_mesh.frag").c_str(), depthDefines);
+        glGenFramebuffers(1, &meshFbo_);
+        glGenVertexArrays(1, &meshVao_);
+    } else {
+        warpProg_ = createComputeProgram(path("warp_depth.comp").c_str(), keyDefines + dispDefines);
+        resolveProg_ = createComputeProgram(path("warp_color.comp").c_str(), keyDefines + dispDefines);
+        if (keyStats_) {
+            glGenBuffers(1, &statsBuf_);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuf_);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, 3 * sizeof(uint32_t), nullptr, GL_DYNAMIC_READ);
+            glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+    }
+    if (deferred()) gatherProg_ = createComputeProgram(path("gather_color.comp").c_str(), depthDefines);
+    // 行网格没有空洞，不需要 fill
+    if (warp == WarpVariant::Mesh) return warpProg_ && (!deferred() || gatherProg_);
+    const std::string fillDefines = fillStats_ ? "#define FILL_STATS\n" : "";
+    if (fill == FillVariant::TilePrefix) {
+        tileProg_ = createComputeProgram(path("fill_tile.comp").c_str(), fillDefines);
+        prefixProg_ = createComputeProgram(path("fill_prefix.comp").c_str());
+    } else {
+        tileProg_ = createComputeProgram(path("fill_tile_gl.comp").c_str(), fillDefines);
+    }
+    if (fillStats_) {
+        glGenBuffers(1, &fillStatsBuf_);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, fillStatsBuf_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, 3 * sizeof(uint32_t), nullptr, GL_DYNAMIC_READ);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    return warpProg_ && (resolveProg_ || singlePassWarp()) && tileProg_ && (fill != FillVariant::TilePrefix || prefixProg_) &&
+           (!deferred() || gatherProg_);
+}
+
+bool StereoPipeline::setDepthBits(int bits, bool keyStats) {
+    if (bits < 8 || bits > 16) {
+        std::cerr << "Depth bits must be in 8..16: " << bits << std::endl;
+        return false;
+    }
+    depthBits_ = bits;
+    keyStats_ = keyStats;
+    return true;
+}
+
+bool StereoPipeline::readKeyStats(KeyStats &stats) {
+    if (!statsBuf_) return false;
+    uint32_t counts[3] = {0, 0, 0};
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuf_);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counts), counts);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    stats.atomics = counts[0];
+    stats.raises = counts[1];
+    stats.tieLosses = counts[2];
+    return true;
+}
+
+void StereoPipeline::setFillBound(bool bounded, bool fillStats) {
+    fillBound_ = bounded;
+    fillStats_ = fillStats;
+}
+
+void StereoPipeline::setSharedDisparity(bool shared, const std::string &shaderDir) {
+    sharedDisp_ = shared;
+    dispShaderDir_ = shaderDir;
+}
+
+void StereoPipeline::setDepthNormalize(DepthNormalize mode, float lowPercent, float highPercent) {
+    depthNorm_ = mode;
+    lowPercent_ = lowPercent;
+    highPercent_ = highPercent;
+}
+
+bool StereoPipeline::loadRangePrograms() {
+    if (rangeProgs_[0]) return true;
+    std::string file = shaderDir_.empty() ? std::string("depth_range.comp") : shaderDir_ + "/depth_range.comp";
+    const std::string decode = depthDecodeSource(shaderDir_);
+    for (int pass = 0; pass < 4; ++pass) {
+        // 调试灰度图按 warp 的同一公式归一化
+        std::string defines = "#define RANGE_PASS " + std::to_string(pass) + "\n";
+        if (pass == 3) defines += "#define DEPTH_NORM\n";
+        rangeProgs_[pass] = createComputeProgram(file.c_str(), defines + decode);
+        if (!rangeProgs_[pass]) return false;
+    }
+    // 统计状态的初值：min 为全 1，max 与直方图为 0；之后每帧由求解 pass 复位
+    std::vector<uint32_t> state(2 + kRangeBins, 0u);
+    state[0] = 0xFFFFFFFFu;
+    glGenBuffers(1, &rangeBuf_);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, rangeBuf_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(state.size() * sizeof(uint32_t)), state.data(), GL_DYNAMIC_COPY);
+    // normLo / normScale / min / max / lo / hi，初值为恒等映射
+    const float identity[6] = {0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    glGenBuffers(1, &normBuf_);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, normBuf_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(identity), identity, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return true;
+}
+
+bool StereoPipeline::readDepthRange(DepthRange &range) {
+    if (!normalizeDepth_) return false;
+    float values[6];
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, normBuf_);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(values), values);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    range.normLo = values[0];
+    range.normScale = values[1];
+    range.min = values[2];
+    range.max = values[3];
+    range.lo = values[4];
+    range.hi = values[5];
+    return true;
+}
+
+bool StereoPipeline::readFillStats(FillStats &stats) {
+    if (!fillStatsBuf_) return false;
+    uint32_t counts[3] = {0, 0, 0};
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, fillStatsBuf_);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counts), counts);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    stats.workgroups = counts[0];
+    stats.barriers = counts[1];
+    stats.fallbacks = counts[2];
+    return true;
+}
+
+int StereoPipeline::maxHoleOf(float shiftScale) {
+    return int(std::ceil(std::fabs(shiftScale))) + 2;
+}
+
+// Scatter / SplitPass 的竞争与回填之间经竞争键纹理传递；单趟 warp 与 Mesh 不需要
+static bool usesKeyTexture(WarpVariant warp) {
+    return warp == WarpVariant::Scatter || warp == WarpVariant::SplitPass;
+}
+
+// 至少 8 位，保证深度位 <= 24
+int StereoPipeline::keyIndexBits(int width) {
+    int bits = 8;
+    while ((1 << bits) <= width) ++bits;
+    return bits;
+}
+
+void StereoPipeline::allocateTargets(int width, int height) {
+    releaseTargets();
+    width_ = allocWidth_ = width;
+    height_ = height;
+    window_ = ColumnWindow();
+    numTile_ = (width + TILE_W - 1) / TILE_W;
+    idxBits_ = keyIndexBits(width);
+
+    for (EyeTargets *eye : {&left, &right}) {
+        eye->color = pool_.acquire(GL_RGBA8, width, height);
+        eye->index = pool_.acquire(GL_R32UI, width, height);
+        clearTextureRGBA8(eye->color, 0, 0, 0, 0);
+        clearTextureR32UI(eye->index, 0xFFFFFFFFu);
+    }
+    if (meshWarp()) meshDepth_ = pool_.acquire(GL_DEPTH_COMPONENT32F, width, height);
+    if (dispProg_) {
+        // 经采样器 texelFetch 读取：默认的 mipmap 缩小过滤会让单层纹理不完整
+        dispTex_ = pool_.acquire(GL_R32F, width, height);
+        glBindTexture(GL_TEXTURE_2D, dispTex_);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    for (EyeTargets *eye : {&left, &right}) {
+        if (eye == &right && !interleaveEyes_) {
+            // 两眼共用：帧图按同一纹理上的读写冲突把右眼的 pass 排在左眼之后
+            right.key = left.key;
+            right.edge = left.edge;
+            break;
+        }
+        if (usesKeyTexture(warpVariant_)) eye->key = pool_.acquire(GL_R32UI, width, height);
+        if (fillVariant_ == FillVariant::TilePrefix && !meshWarp()) {
+            eye->edge = pool_.acquire(GL_RGBA32UI, numTile_ * 2, height); // 每 tile 2 像素
+            clearTextureRGBA32UI(eye->edge, 0u, 0u, 0u, 0u);
+        }
+    }
+    if (colorResolve_ == ColorResolve::Splat) {
+        glGenBuffers(1, &accumBuf_);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, accumBuf_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(size_t(width) * height * 16), nullptr, GL_DYNAMIC_COPY);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    pool_.trim(poolLimit_);
+}
+
+size_t StereoPipeline::targetBytes(int width, int height, WarpVariant warp, FillVariant fill, ColorResolve color,
+                                   bool sharedDisparity, bool interleaveEyes) {
+    int numTile = (width + TILE_W - 1) / TILE_W;
+    bool mesh = warp == WarpVariant::Mesh;
+    // 每眼：颜色 + 索引；每眼（交错时）或两眼共用：竞争键 + edge
+    size_t eyeBytes = TexturePool::textureBytes(GL_RGBA8, width, height) + TexturePool::textureBytes(GL_R32UI, width, height);
+    size_t scratchBytes = 0;
+    if (usesKeyTexture(warp)) scratchBytes += TexturePool::textureBytes(GL_R32UI, width, height);
+    if (fill == FillVariant::TilePrefix && !mesh) scratchBytes += TexturePool::textureBytes(GL_RGBA32UI, numTile * 2, height);
+    size_t bytes = 2 * eyeBytes + (interleaveEyes ? 2 : 1) * scratchBytes;
+    if (mesh) bytes += TexturePool::textureBytes(GL_DEPTH_COMPONENT32F, width, height);
+    if (color == ColorResolve::Splat) bytes += TexturePool::textureBytes(GL_RGBA32UI, width, height);
+    if (sharedDisparity) bytes += TexturePool::textureBytes(GL_R32F, width, height);
+    return bytes;
+}
+
+bool StereoPipeline::setSource(GLuint colorTex, GLuint depthTex) {
+    srcColor_ = colorTex;
+    srcDepth_ = depthTex;
+    depthOffsetX_ = depthOffsetY_ = 0;
+    depthEncoding_ = DepthEncoding::Float;
+    if (!colorTex || (!sbsInput() && !depthTex)) {
+        std::cerr << variantName(warpVariant_) << " warp needs a color and a depth texture" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool StereoPipeline::setSource(const RGBDInput &input) {
+    srcColor_ = input.colorTex;
+    srcDepth_ = input.depthTex;
+    depthOffsetX_ = input.depthOffsetX;
+    depthOffsetY_ = input.depthOffsetY;
+    depthEncoding_ = input.encoding;
+    if (sbsInput() && (input.layout != InputLayout::SideBySide || input.encoding != DepthEncoding::R8)) {
+        std::cerr << "SplitPass / SplitGather expect SBS input with R8 depth" << std::endl;
+        return false;
+    }
+    if (!srcColor_ || !srcDepth_) {
+        std::cerr << "RGB-D input has no texture" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void StereoPipeline::setColumnWindow(const ColumnWindow &window) {
+    window_ = window;
+    width_ = window.width > 0 ? window.width : allocWidth_;
+    numTile_ = (width_ + TILE_W - 1) / TILE_W;
+    // 量化深度的位数取决于竞争键位数，必须与整幅一致
+    idxBits_ = keyIndexBits(referenceWidth());
+}
+
+void StereoPipeline::bindSource() const {
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, srcColor_);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, srcDepth_);
+    if (dispTex_) {
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, dispTex_);
+    }
+    if (normalizeDepth_) glBindBufferBase(GL_UNIFORM_BUFFER, 0, normBuf_);
+}
+
+// warp.comp / warp_splat.comp / warp_gather.comp / warp_row.comp / warp_mesh 共用的投射参数
+void StereoPipeline::setWarpUniforms(GLuint prog, int eyeSign) const {
+    int padSize = this->padSize();
+    float shiftScale = shiftScaleFor(eyeSign);
+    glUniform1i(glGetUniformLocation(prog, "srcColor"), 0);
+    glUniform1i(glGetUniformLocation(prog, "srcDepth"), 1);
+    glUniform1i(glGetUniformLocation(prog, "orgWidth"), width_);
+    glUniform1i(glGetUniformLocation(prog, "orgHeight"), height_);
+    glUniform1i(glGetUniformLocation(prog, "padSize"), padSize);
+    glUniform1i(glGetUniformLocation(prog, "paddedWidth"), width_ + padSize * 2);
+    glUniform1f(glGetUniformLocation(prog, "shiftScale"), shiftScale);
+    glUniform1f(glGetUniformLocation(prog, "shiftBias"), -params_.convergence * shiftScale);
+    glUniform1i(glGetUniformLocation(prog, "idxBits"), idxBits_);
+    glUniform2i(glGetUniformLocation(prog, "depthOffset"), depthOffsetX_, depthOffsetY_);
+    glUniform1i(glGetUniformLocation(prog, "depthEncoding"), int(depthEncoding_));
+    glUniform1i(glGetUniformLocation(prog, "originX"), window_.width > 0 ? window_.originX : 0);
+    glUniform1i(glGetUniformLocation(prog, "srcDisp"), 2);
+}
+
+// SplitPass / SplitGather：只做水平视差，padSizeY = 0
+void StereoPipeline::setSplitUniforms(GLuint prog, int eyeSign) const {
+    int padSize = this->padSize();
+    float shiftScale = shiftScaleFor(eyeSign);
+    glUniform1i(glGetUniformLocation(prog, "srcColor"), 0);
+    glUniform1i(glGetUniformLocation(prog, "orgWidth"), width_);
+    glUniform1i(glGetUniformLocation(prog, "orgHeight"), height_);
+    glUniform1i(glGetUniformLocation(prog, "padSizeX"), padSize);
+    glUniform1i(glGetUniformLocation(prog, "padSizeY"), 0);
+    glUniform1i(glGetUniformLocation(prog, "paddedWidth"), width_ + padSize * 2);
+    glUniform1i(glGetUniformLocation(prog, "paddedHeight"), height_);
+    glUniform1f(glGetUniformLocation(prog, "shiftScaleX"), shiftScale);
+    glUniform1f(glGetUniformLocation(prog, "shiftBiasX"), -params_.convergence * shiftScale);
+    glUniform1f(glGetUniformLocation(prog, "shiftScaleY"), 0.0f);
+    glUniform1f(glGetUniformLocation(prog, "shiftBiasY"), 0.0f);
+    glUniform1i(glGetUniformLocation(prog, "srcDisp"), 2);
+}
+
+// 深度范围：各工作组归约后原子合并 min / max（Percentile 再统计直方图），单工作组求解出归一化参数，
+// 同时复位统计状态。参数留在 GPU 上，warp 经 uniform 块读取
+void StereoPipeline::addDepthRangePasses(FrameGraph &graph, bool percentile) {
+    ResourceUse srcDepth{texResource(srcDepth_, "src depth"), Access::Sampled};
+    FrameResource state = bufResource(rangeBuf_, "depth range");
+    FrameResource norm = bufResource(normBuf_, "depth norm");
+    auto bindDepth = [this](GLuint prog) {
+        glUseProgram(prog);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, srcDepth_);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, rangeBuf_);
+        glUniform1i(glGetUniformLocation(prog, "srcDepth"), 1);
+        glUniform1i(glGetUniformLocation(prog, "orgWidth"), width_);
+        glUniform1i(glGetUniformLocation(prog, "orgHeight"), height_);
+        glUniform2i(glGetUniformLocation(prog, "depthOffset"), depthOffsetX_, depthOffsetY_);
+        glUniform1i(glGetUniformLocation(prog, "depthEncoding"), int(depthEncoding_));
+    };
+    GLuint gx = (width_ + 15) / 16;
+    GLuint gy = (height_ + 15) / 16;
+    graph.addPass("depth range", {srcDepth, {state, Access::StorageAtomic}}, [=] {
+        bindDepth(rangeProgs_[0]);
+        glDispatchCompute(gx, gy, 1);
+    });
+    if (percentile) {
+        // 读 min / max 决定分段，直方图的原子加与上一趟的 min / max 隔开
+        graph.addPass("depth histogram", {srcDepth, {state, Access::StorageReadWrite}}, [=] {
+            bindDepth(rangeProgs_[1]);
+            glDispatchCompute(gx, gy, 1);
+        });
+    }
+    graph.addPass("depth resolve", {{state, Access::StorageReadWrite}, {norm, Access::StorageReadWrite}}, [=] {
+        GLuint prog = rangeProgs_[2];
+        glUseProgram(prog);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, rangeBuf_);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, normBuf_);
+        glUniform1i(glGetUniformLocation(prog, "percentile"), percentile ? 1 : 0);
+        glUniform1f(glGetUniformLocation(prog, "lowPercent"), lowPercent_);
+        glUniform1f(glGetUniformLocation(prog, "highPercent"), highPercent_);
+        glDispatchCompute(1, 1, 1);
+    });
+    // 下一帧的 min / max 原子归约
+    graph.addOutput(state, Access::StorageAtomic);
+}
+
+ResourceUse StereoPipeline::depthNormUse() const {
+    return {bufResource(normalizeDepth_ ? normBuf_ : 0, "depth norm"), Access::Uniform};
+}
+
+bool StereoPipeline::readDepthPreview(std::vector<uint8_t> &gray) {
+    if (sbsInput()) {
+        std::cerr << "Depth preview needs a separate or packed depth source" << std::endl;
+        return false;
+    }
+    if (!loadRangePrograms()) return false;
+    GLuint tex = pool_.acquire(GL_R8UI, width_, height_);
+    FrameGraph graph;
+    graph.reset("depth preview");
+    if (!normalizeDepth_) addDepthRangePasses(graph, false);
+    ResourceUse srcDepth{texResource(srcDepth_, "src depth"), Access::Sampled};
+    ResourceUse norm{bufResource(normBuf_, "depth norm"), Access::Uniform};
+    ResourceUse out{texResource(tex, "depth gray"), Access::ImageWrite};
+    graph.addPass("depth preview", {srcDepth, norm, out}, [=] {
+        GLuint prog = rangeProgs_[3];
+        glUseProgram(prog);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, srcDepth_);
+        glBindBufferBase(GL_UNIFORM_BUFFER, 0, normBuf_);
+        glBindImageTexture(6, tex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8UI);
+        glUniform1i(glGetUniformLocation(prog, "srcDepth"), 1);
+        glUniform1i(glGetUniformLocation(prog, "orgWidth"), width_);
+        glUniform1i(glGetUniformLocation(prog, "orgHeight"), height_);
+        glUniform2i(glGetUniformLocation(prog, "depthOffset"), depthOffsetX_, depthOffsetY_);
+        glUniform1i(glGetUniformLocation(prog, "depthEncoding"), int(depthEncoding_));
+        glDispatchCompute((width_ + 15) / 16, (height_ + 15) / 16, 1);
+    });
+    graph.addOutput(out.resource, Access::Readback);
+    graph.execute();
+
+    gray.resize(size_t(width_) * height_);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, gray.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    pool_.recycle(tex);
+    pool_.trim(poolLimit_);
+    return true;
+}
+
+bool StereoPipeline::setOutputFormat(OutputFormat format, const std::string &shaderDir) {
+    outputFormat_ = format;
+    GLuint &prog = packProgs_[int(format)];
+    if (format == OutputFormat::RGBA || prog) return true;
+    std::string dir = shaderDir.empty() ? shaderDir_ : shaderDir;
+    std::string file = dir.empty() ? std::string("pack_output.comp") : dir + "/pack_output.comp";
+    prog = createComputeProgram(file.c_str(), "#define PACK_FORMAT " + std::to_string(int(format)) + "\n");
+    return prog != 0;
+}
+
+bool StereoPipeline::readOutput(void *left, void *right) {
+    size_t bytes = outputBytes(outputFormat_, width_, height_);
+    if (outputFormat_ != OutputFormat::RGBA && packBytes_ < bytes) {
+        std::cerr << "No packed output for the current size / format; run fill() first" << std::endl;
+        return false;
+    }
+    void *dst[2] = {left, right};
+    const EyeTargets *eyes[2] = {&this->left, &this->right};
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    for (int i = 0; i < 2; ++i) {
+        if (!dst[i]) continue;
+        if (outputFormat_ == OutputFormat::RGBA) {
+            glBindTexture(GL_TEXTURE_2D, eyes[i]->color);
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, dst[i]);
+        } else {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, packBuf_[i]);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(bytes), dst[i]);
+        }
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+bool StereoPipeline::copyOutput(GLuint left, GLuint right) {
+    size_t bytes = outputBytes(outputFormat_, width_, height_);
+    if (outputFormat_ == OutputFormat::RGBA || packBytes_ < bytes) {
+        std::cerr << "No packed output for the current size / format; set a packed format and run fill() first"
+                  << std::endl;
+        return false;
+    }
+    const GLuint dst[2] = {left, right};
+    for (int i = 0; i < 2; ++i) {
+        if (!dst[i]) continue;
+        glBindBuffer(GL_COPY_READ_BUFFER, packBuf_[i]);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, dst[i]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(bytes));
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return true;
+}
+
+// 共用视差：把源深度（含归一化）解码一次写成 R32F，两眼的 warp 各按自己的 shiftScale / shiftBias 算视差与竞争键
+void StereoPipeline::addDisparityPass(FrameGraph &graph) {
+    if (!dispProg_) return;
+    bool split = sbsInput();
+    ResourceUse srcColor{texResource(split ? srcColor_ : 0, "src color"), Access::Sampled};
+    ResourceUse srcDepth{texResource(split ? 0 : srcDepth_, "src depth"), Access::Sampled};
+    ResourceUse disp{texResource(dispTex_, "disparity"), Access::ImageWrite};
+    graph.addPass("disparity", {srcColor, srcDepth, disp, depthNormUse()}, [=] {
+        glUseProgram(dispProg_);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, split ? srcColor_ : srcDepth_);
+        glBindImageTexture(6, dispTex_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        if (normalizeDepth_) glBindBufferBase(GL_UNIFORM_BUFFER, 0, normBuf_);
+        glUniform1i(glGetUniformLocation(dispProg_, "srcDepth"), 1);
+        glUniform1i(glGetUniformLocation(dispProg_, "orgWidth"), width_);
+        glUniform1i(glGetUniformLocation(dispProg_, "orgHeight"), height_);
+        glUniform2i(glGetUniformLocation(dispProg_, "depthOffset"), split ? width_ : depthOffsetX_,
+                    split ? 0 : depthOffsetY_);
+        glUniform1i(glGetUniformLocation(dispProg_, "depthEncoding"), int(split ? DepthEncoding::Float : depthEncoding_));
+        glDispatchCompute((width_ + 15) / 16, (height_ + 15) / 16, 1);
+    });
+}
+
+// 每个 pass 自己绑定程序、纹理单元、image / SSBO 与 uniform：同层的另一只眼会在中间改掉这些状态
+void StereoPipeline::addWarpPasses(FrameGraph &graph, const EyeTargets &eye, int eyeSign) {
+    bool l = eyeSign > 0;
+    bool deferred = this->deferred();
+    int paddedW = width_ + padSize() * 2;
+    ResourceUse srcColor{texResource(srcColor_, "src color"), Access::Sampled};
+    ResourceUse srcDepth{texResource(sbsInput() ? 0 : srcDepth_, "src depth"), Access::Sampled};
+    // 延迟取色时 warp 不写颜色
+    ResourceUse color{texResource(deferred ? 0 : eye.color, l ? "color L" : "color R"), Access::ImageWrite};
+    ResourceUse index{texResource(eye.index, l ? "index L" : "index R"), Access::ImageWrite};
+    FrameResource key = texResource(eye.key, l ? "key L" : "key R");
+
+    if (meshWarp()) {
+        // 每行 paddedW 列 x 上下两个顶点的三角形带，实例号为行号；深度测试取最近表面，
+        // GEQUAL：深度 0 的表面也绘制，深度相同时后绘制（源列大）的胜出，与竞争键的裁决一致。
+        // 网格连续覆盖整行，每个像素都被写到，不需要预先复位颜色 / 索引。深度缓冲两眼共用，两眼的绘制由帧图串行
+        color.access = index.access = Access::RenderTarget;
+        ResourceUse depth{texResource(meshDepth_, "mesh depth"), Access::RenderTarget};
+        graph.addPass(l ? "warp L" : "warp R", {srcColor, srcDepth, color, index, depth, depthNormUse()}, [=] {
+            bindSource();
+            glBindFramebuffer(GL_FRAMEBUFFER, meshFbo_);
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, eye.color, 0);
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, eye.index, 0);
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, meshDepth_, 0);
+            const GLenum buffers[2] = {GLenum(deferred ? GL_NONE : GL_COLOR_ATTACHMENT0), GL_COLOR_ATTACHMENT1};
+            glDrawBuffers(2, buffers);
+            const GLfloat farDepth = 0.0f;
+            glClearBufferfv(GL_DEPTH, 0, &farDepth);
+
+            glViewport(0, 0, width_, height_);
+            glEnable(GL_DEPTH_TEST);
+            glDepthFunc(GL_GEQUAL);
+            glUseProgram(warpProg_);
+            setWarpUniforms(warpProg_, eyeSign);
+            glBindVertexArray(meshVao_);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, paddedW * 2, height_);
+            glBindVertexArray(0);
+            glDisable(GL_DEPTH_TEST);
+            glDepthFunc(GL_LESS);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        });
+        return;
+    }
+
+    if (singlePassWarp()) {
+        // 单趟（反向查找 / 行内共享内存竞争），直接写颜色 / 索引：每个工作组一行 256 个目标像素
+        graph.addPass(l ? "warp L" : "warp R", {srcColor, srcDepth, color, index, depthNormUse()}, [=] {
+            bindSource();
+            glUseProgram(warpProg_);
+            glBindImageTexture(2, eye.color, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+            glBindImageTexture(4, eye.index, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32UI);
+            if (sbsInput()) setSplitUniforms(warpProg_, eyeSign);
+            else setWarpUniforms(warpProg_, eyeSign);
+            glUniform1i(glGetUniformLocation(warpProg_, "indexOnly"), deferred ? 1 : 0);
+            glDispatchCompute((width_ + 255) / 256, height_, 1);
+        });
+        return;
+    }
+
+    // 竞争键每眼一份，只在本眼的竞争与回填之间有效；清零是 FBO 写入，与之后的 image 访问自动有序
+    graph.addPass(l ? "clear key L" : "clear key R", {{key, Access::RenderTarget}},
+                  [=] { clearTextureR32UI(eye.key, 0u); });
+
+    GLuint gx = (paddedW + 15) / 16;
+    GLuint gy = (height_ + 15) / 16;
+    ResourceUse disp{texResource(dispTex_, "disparity"), Access::Sampled};
+    if (warpVariant_ == WarpVariant::SplitPass) {
+        ResourceUse stats{bufResource(statsBuf_, "key stats"), Access::StorageAtomic};
+        // Pass-1 : 最大竞争键
+        graph.addPass(l ? "warp depth L" : "warp depth R", {srcColor, disp, {key, Access::ImageReadWrite}, stats}, [=] {
+            bindSource();
+            if (statsBuf_) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, statsBuf_);
+            glUseProgram(warpProg_);
+            glBindImageTexture(3, eye.key, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+            setSplitUniforms(warpProg_, eyeSign);
+            glDispatchCompute(gx, gy, 1);
+        });
+        // Pass-2 : 写颜色 / 索引（延迟取色时只写索引）
+        graph.addPass(l ? "warp color L" : "warp color R",
+                      {srcColor, disp, {key, Access::ImageRead}, color, index, stats}, [=] {
+            bindSource();
+            if (statsBuf_) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, statsBuf_);
+            glUseProgram(resolveProg_);
+            glBindImageTexture(2, eye.color, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+            glBindImageTexture(3, eye.key, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32UI);
+            glBindImageTexture(4, eye.index, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32UI);
+            setSplitUniforms(resolveProg_, eyeSign);
+            glUniform1i(glGetUniformLocation(resolveProg_, "indexOnly"), deferred ? 1 : 0);
+            glDispatchCompute(gx, gy, 1);
+        });
+        return;
+    }
+
+    // 共用视差时 warp 不读深度
+    ResourceUse norm = dispTex_ ? ResourceUse{} : depthNormUse();
+    graph.addPass(l ? "warp L" : "warp R",
+                  {srcColor, dispTex_ ? disp : srcDepth, {key, Access::ImageReadWrite}, norm}, [=] {
+        bindSource();
+        glUseProgram(warpProg_);
+        glBindImageTexture(3, eye.key, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+        setWarpUniforms(warpProg_, eyeSign);
+        glDispatchCompute(gx, gy, 1);
+    });
+
+    // 累加缓冲两眼共用：归一化读完即清零，下一眼的累加由帧图排在它之后
+    ResourceUse accum{bufResource(accumBuf_, "splat accum"), Access::StorageAtomic};
+    if (splatProg_) {
+        // 按覆盖率累加与胜者同一表面（量化深度差 1/64 以内）的源颜色
+        graph.addPass(l ? "splat L" : "splat R",
+                      {srcColor, srcDepth, {key, Access::ImageRead}, accum, depthNormUse()}, [=] {
+            bindSource();
+            glUseProgram(splatProg_);
+            glBindImageTexture(3, eye.key, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32UI);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, accumBuf_);
+            setWarpUniforms(splatProg_, eyeSign);
+            GLuint maxQ = (1u << (32 - idxBits_)) - 1u;
+            glUniform1ui(glGetUniformLocation(splatProg_, "surfaceTol"), maxQ >> 6);
+            glDispatchCompute(gx, gy, 1);
+        });
+        accum.access = Access::StorageReadWrite;
+    }
+
+    // 按竞争键回填颜色/索引（每像素单写者，无竞态）；Splat 时为归一化累加颜色
+    graph.addPass(l ? "resolve L" : "resolve R", {srcColor, {key, Access::ImageRead}, color, index, accum}, [=] {
+        bindSource();
+        glUseProgram(resolveProg_);
+        glUniform1i(glGetUniformLocation(resolveProg_, "srcColor"), 0);
+        glBindImageTexture(2, eye.color, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        glBindImageTexture(3, eye.key, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32UI);
+        glBindImageTexture(4, eye.index, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32UI);
+        if (accumBuf_) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, accumBuf_);
+        glUniform1i(glGetUniformLocation(resolveProg_, "orgWidth"), width_);
+        glUniform1i(glGetUniformLocation(resolveProg_, "orgHeight"), height_);
+        glUniform1i(glGetUniformLocation(resolveProg_, "idxBits"), idxBits_);
+        glUniform1i(glGetUniformLocation(resolveProg_, "indexOnly"), deferred ? 1 : 0);
+        glDispatchCompute((width_ + 15) / 16, (height_ + 15) / 16, 1);
+    });
+}
+
+void StereoPipeline::addFillPasses(FrameGraph &graph, const EyeTargets &eye, int eyeSign) {
+    bool l = eyeSign > 0;
+    bool deferred = this->deferred();
+    if (meshWarp()) {
+        if (deferred) addGatherPass(graph, eye, eyeSign);
+        return;
+    }
+    // 延迟取色时 fill 只搬运索引
+    ResourceUse color{texResource(deferred ? 0 : eye.color, l ? "color L" : "color R"), Access::ImageReadWrite};
+    ResourceUse index{texResource(eye.index, l ? "index L" : "index R"), Access::ImageReadWrite};
+    ResourceUse stats{bufResource(fillStatsBuf_, "fill stats"), Access::StorageAtomic};
+    int maxHole = maxHoleFor(eyeSign);
+
+    if (fillVariant_ == FillVariant::LogShift) {
+        graph.addPass(l ? "fill L" : "fill R", {color, index, stats}, [=] {
+            glUseProgram(tileProg_);
+            glBindImageTexture(6, eye.color, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+            glBindImageTexture(2, eye.color, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+            glBindImageTexture(4, eye.index, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+            glUniform1i(glGetUniformLocation(tileProg_, "orgWidth"), width_);
+            glUniform1i(glGetUniformLocation(tileProg_, "orgHeight"), height_);
+            glUniform1i(glGetUniformLocation(tileProg_, "eyeSign"), eyeSign);
+            glUniform1i(glGetUniformLocation(tileProg_, "indexOnly"), deferred ? 1 : 0);
+            glUniform1i(glGetUniformLocation(tileProg_, "maxHole"), maxHole);
+            if (fillStatsBuf_) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, fillStatsBuf_);
+            glDispatchCompute(numTile_, height_, 1);
+        });
+        if (deferred) addGatherPass(graph, eye, eyeSign);
+        return;
+    }
+
+    FrameResource edge = texResource(eye.edge, l ? "edge L" : "edge R");
+    // Pass-B-1 : tile 内 shift_fill / fix / shift_fill
+    graph.addPass(l ? "fill tile L" : "fill tile R", {color, index, {edge, Access::ImageWrite}, stats}, [=] {
+        glUseProgram(tileProg_);
+        glBindImageTexture(2, eye.color, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8);
+        glBindImageTexture(4, eye.index, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+        glBindImageTexture(5, eye.edge, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32UI);
+        glUniform1i(glGetUniformLocation(tileProg_, "orgWidth"), width_);
+        glUniform1i(glGetUniformLocation(tileProg_, "orgHeight"), height_);
+        glUniform1i(glGetUniformLocation(tileProg_, "eyeSign"), eyeSign);
+        glUniform1i(glGetUniformLocation(tileProg_, "indexOnly"), deferred ? 1 : 0);
+        glUniform1i(glGetUniformLocation(tileProg_, "maxHole"), maxHole);
+        if (fillStatsBuf_) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, fillStatsBuf_);
+        glDispatchCompute(numTile_, height_, 1);
+    });
+
+    // Pass-B-2 : tile 间前缀传播
+    // 列分块：只扫描本块的核心 tile，行首 / 行尾状态经 carry 在块之间接力
+    GLuint carry = l ? window_.carryLeft : window_.carryRight;
+    bool tiled = window_.width > 0 && carry;
+    ResourceUse carryUse{texResource(tiled ? carry : 0, l ? "carry L" : "carry R"), Access::ImageReadWrite};
+    graph.addPass(l ? "fill prefix L" : "fill prefix R", {color, index, {edge, Access::ImageRead}, carryUse}, [=] {
+        glUseProgram(prefixProg_);
+        glBindImageTexture(2, eye.color, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8);
+        glBindImageTexture(4, eye.index, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+        glBindImageTexture(5, eye.edge, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32UI);
+        glUniform1i(glGetUniformLocation(prefixProg_, "orgWidth"), width_);
+        glUniform1i(glGetUniformLocation(prefixProg_, "orgHeight"), height_);
+        glUniform1i(glGetUniformLocation(prefixProg_, "numTile"), numTile_);
+        glUniform1i(glGetUniformLocation(prefixProg_, "indexOnly"), deferred ? 1 : 0);
+        glUniform1i(glGetUniformLocation(prefixProg_, "tileBegin"), tiled ? window_.tileBegin : 0);
+        glUniform1i(glGetUniformLocation(prefixProg_, "tileEnd"), tiled ? window_.tileEnd : numTile_);
+        glUniform1i(glGetUniformLocation(prefixProg_, "useCarry"), tiled ? 1 : 0);
+        if (tiled) glBindImageTexture(7, carry, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32UI);
+        glDispatchCompute(1, height_, 1);
+    });
+    if (deferred) addGatherPass(graph, eye, eyeSign);
+}
+
+void StereoPipeline::addGatherPass(FrameGraph &graph, const EyeTargets &eye, int eyeSign) {
+    // Pass-C : 按最终索引从原图取色
+    bool l = eyeSign > 0;
+    bool split = sbsInput();
+    float shiftScale = shiftScaleFor(eyeSign);
+    ResourceUse srcColor{texResource(srcColor_, "src color"), Access::Sampled};
+    ResourceUse srcDepth{texResource(split ? 0 : srcDepth_, "src depth"), Access::Sampled};
+    ResourceUse color{texResource(eye.color, l ? "color L" : "color R"), Access::ImageWrite};
+    ResourceUse index{texResource(eye.index, l ? "index L" : "index R"), Access::ImageRead};
+    graph.addPass(l ? "gather L" : "gather R", {srcColor, srcDepth, color, index, depthNormUse()}, [=] {
+        glUseProgram(gatherProg_);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, srcColor_);
+        glUniform1i(glGetUniformLocation(gatherProg_, "srcColor"), 0);
+        // SplitPass 的深度在 SBS 纹理右半 R 通道
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, split ? srcColor_ : srcDepth_);
+        glUniform1i(glGetUniformLocation(gatherProg_, "srcDepth"), 1);
+        if (normalizeDepth_) glBindBufferBase(GL_UNIFORM_BUFFER, 0, normBuf_);
+        glBindImageTexture(2, eye.color, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        glBindImageTexture(4, eye.index, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32UI);
+        glUniform1i(glGetUniformLocation(gatherProg_, "orgWidth"), width_);
+        glUniform1i(glGetUniformLocation(gatherProg_, "orgHeight"), height_);
+        glUniform1i(glGetUniformLocation(gatherProg_, "bilinear"),
+                    colorResolve_ == ColorResolve::DeferredBilinear ? 1 : 0);
+        glUniform1f(glGetUniformLocation(gatherProg_, "shiftScale"), shiftScale);
+        glUniform1f(glGetUniformLocation(gatherProg_, "shiftBias"), -params_.convergence * shiftScale);
+        glUniform2i(glGetUniformLocation(gatherProg_, "depthOffset"), split ? width_ : depthOffsetX_,
+                    split ? 0 : depthOffsetY_);
+        glUniform1i(glGetUniformLocation(gatherProg_, "depthEncoding"),
+                    int(split ? DepthEncoding::Float : depthEncoding_));
+        glDispatchCompute((width_ + 15) / 16, (height_ + 15) / 16, 1);
+    });
+}
+
+// warp 之后由 fill 经 image 读写颜色 / 索引
+void StereoPipeline::addWarpOutputs(FrameGraph &graph, const EyeTargets &eye, int eyeSign) {
+    bool l = eyeSign > 0;
+    graph.addOutput(texResource(eye.color, l ? "color L" : "color R"), Access::ImageReadWrite);
+    graph.addOutput(texResource(eye.index, l ? "index L" : "index R"), Access::ImageReadWrite);
+}
+
+// fill 之后：调用方读回颜色（或打包缓冲），下一帧的 warp 重写颜色 / 索引
+// （SplitPass 先由 resetTargets 经 FBO 复位索引），列分块的下一块读写 carry
+void StereoPipeline::addFillOutputs(FrameGraph &graph, const EyeTargets &eye, int eyeSign) {
+    bool l = eyeSign > 0;
+    FrameResource color = texResource(eye.color, l ? "color L" : "color R");
+    FrameResource index = texResource(eye.index, l ? "index L" : "index R");
+    graph.addOutput(color, Access::Readback);
+    if (outputFormat_ != OutputFormat::RGBA)
+        graph.addOutput(bufResource(packBuf_[l ? 0 : 1], l ? "packed L" : "packed R"), Access::Readback);
+    graph.addOutput(color, Access::ImageWrite);
+    graph.addOutput(index, Access::ImageWrite);
+    if (warpVariant_ == WarpVariant::SplitPass) graph.addOutput(index, Access::RenderTarget);
+    if (window_.width > 0)
+        graph.addOutput(texResource(l ? window_.carryLeft : window_.carryRight, l ? "carry L" : "carry R"),
+                        Access::ImageReadWrite);
+}
+
+// 打包缓冲按字数取整，尺寸或格式变化时重新分配
+void StereoPipeline::ensurePackBuffers() {
+    if (outputFormat_ == OutputFormat::RGBA) return;
+    size_t bytes = (outputBytes(outputFormat_, width_, height_) + 3) & ~size_t(3);
+    if (packBuf_[0] && packBytes_ == bytes) return;
+    if (!packBuf_[0]) glGenBuffers(2, packBuf_);
+    for (GLuint buf : packBuf_) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buf);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(bytes), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    packBytes_ = bytes;
+}
+
+// fill 之后采样最终颜色打包进缓冲，调用方经 readOutput 读回
+void StereoPipeline::addPackPass(FrameGraph &graph, const EyeTargets &eye, int eyeSign) {
+    if (outputFormat_ == OutputFormat::RGBA) return;
+    bool l = eyeSign > 0;
+    GLuint buf = packBuf_[l ? 0 : 1];
+    ResourceUse color{texResource(eye.color, l ? "color L" : "color R"), Access::Sampled};
+    ResourceUse packed{bufResource(buf, l ? "packed L" : "packed R"), Access::StorageReadWrite};
+    GLuint colorTex = eye.color;
+    graph.addPass(l ? "pack L" : "pack R", {color, packed}, [=] {
+        GLuint prog = packProgs_[int(outputFormat_)];
+        size_t bytes = outputBytes(outputFormat_, width_, height_);
+        GLuint groups = GLuint((bytes + 1023) / 1024); // 每个调用 4 字节，每组 256 个调用
+        GLuint gx = std::min(groups, 32768u);
+        glUseProgram(prog);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, colorTex);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buf);
+        glUniform1i(glGetUniformLocation(prog, "srcColor"), 0);
+        glUniform1i(glGetUniformLocation(prog, "width"), width_);
+        glUniform1i(glGetUniformLocation(prog, "height"), height_);
+        glUniform1ui(glGetUniformLocation(prog, "totalBytes"), GLuint(bytes));
+        glDispatchCompute(gx, (groups + gx - 1) / gx, 1);
+    });
+}
+
+// 单眼调用时每眼各做一次视差预计算
+void StereoPipeline::warpEye(EyeTargets &eye, int eyeSign) {
+    warpGraph_.reset("warp");
+    if (normalizeDepth_) addDepthRangePasses(warpGraph_, depthNorm_ == DepthNormalize::Percentile);
+    addDisparityPass(warpGraph_);
+    addWarpPasses(warpGraph_, eye, eyeSign);
+    addWarpOutputs(warpGraph_, eye, eyeSign);
+    warpGraph_.execute();
+}
+
+void StereoPipeline::fillEye(EyeTargets &eye, int eyeSign) {
+    ensurePackBuffers();
+    fillGraph_.reset("fill");
+    addFillPasses(fillGraph_, eye, eyeSign);
+    addPackPass(fillGraph_, eye, eyeSign);
+    addFillOutputs(fillGraph_, eye, eyeSign);
+    fillGraph_.execute();
+}
+
+// 两眼的 pass 链按眼依次加入，互不依赖的同级 pass 由帧图排进同一层交错提交，一层共用一次 barrier
+void StereoPipeline::warp() {
+    warpGraph_.reset("warp");
+    if (normalizeDepth_) addDepthRangePasses(warpGraph_, depthNorm_ == DepthNormalize::Percentile);
+    addDisparityPass(warpGraph_);
+    addWarpPasses(warpGraph_, left, +1);
+    addWarpPasses(warpGraph_, right, -1);
+    addWarpOutputs(warpGraph_, left, +1);
+    addWarpOutputs(warpGraph_, right, -1);
+    warpGraph_.execute();
+}
+
+void StereoPipeline::fill() {
+    ensurePackBuffers();
+    fillGraph_.reset("fill");
+    addFillPasses(fillGraph_, left, +1);
+    addFillPasses(fillGraph_, right, -1);
+    addPackPass(fillGraph_, left, +1);
+    addPackPass(fillGraph_, right, -1);
+    addFillOutputs(fillGraph_, left, +1);
+    addFillOutputs(fillGraph_, right, -1);
+    fillGraph_.execute();
+}
+
+void StereoPipeline::dumpSchedule(std::ostream &os) const {
+    warpGraph_.dump(os);
+    fillGraph_.dump(os);
+}
+
+void StereoPipeline::resetTargets() {
+    // warp_color 只写命中的像素，未命中处的旧索引必须复位
+    if (warpVariant_ != WarpVariant::SplitPass) return;
+    for (EyeTargets *eye : {&left, &right})
+        clearTextureR32UI(eye->index, 0xFFFFFFFFu);
+}
+
+void StereoPipeline::releaseTargets() {
+    // 共用的竞争键 / edge 只归还一次
+    if (right.key == left.key) right.key = 0;
+    if (right.edge == left.edge) right.edge = 0;
+    for (EyeTargets *eye : {&left, &right}) {
+        pool_.recycle(eye->color);
+        pool_.recycle(eye->index);
+        pool_.recycle(eye->key);
+        pool_.recycle(eye->edge);
+        *eye = EyeTargets();
+    }
+    pool_.recycle(meshDepth_);
+    pool_.recycle(dispTex_);
+    meshDepth_ = dispTex_ = 0;
+    if (accumBuf_) glDeleteBuffers(1, &accumBuf_);
+    accumBuf_ = 0;
+    if (packBuf_[0]) glDeleteBuffers(2, packBuf_);
+    packBuf_[0] = packBuf_[1] = 0;
+    packBytes_ = 0;
+}
+
+void StereoPipeline::release() {
+    releaseTargets();
+    pool_.release();
+    glDeleteProgram(warpProg_);
+    glDeleteProgram(resolveProg_);
+    glDeleteProgram(tileProg_);
+    glDeleteProgram(prefixProg_);
+    glDeleteProgram(gatherProg_);
+    glDeleteProgram(splatProg_);
+    glDeleteProgram(dispProg_);
+    warpProg_ = resolveProg_ = tileProg_ = prefixProg_ = gatherProg_ = splatProg_ = dispProg_ = 0;
+    if (statsBuf_) glDeleteBuffers(1, &statsBuf_);
+    if (fillStatsBuf_) glDeleteBuffers(1, &fillStatsBuf_);
+    statsBuf_ = fillStatsBuf_ = 0;
+    for (GLuint &prog : rangeProgs_) {
+        glDeleteProgram(prog);
+        prog = 0;
+    }
+    for (GLuint &prog : packProgs_) {
+        glDeleteProgram(prog);
+        prog = 0;
+    }
+    if (rangeBuf_) glDeleteBuffers(1, &rangeBuf_);
+    if (normBuf_) glDeleteBuffers(1, &normBuf_);
+    rangeBuf_ = normBuf_ = 0;
+    if (meshFbo_) glDeleteFramebuffers(1, &meshFbo_);
+    if (meshVao_) glDeleteVertexArrays(1, &meshVao_);
+    meshFbo_ = meshVao_ = 0;
+}
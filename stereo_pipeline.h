@@ -0,0 +1,324 @@
+#pragma once
+// 立体生成流水线：warp（视差变换 + 深度竞争）→ fill（空洞修补）
+// 封装目标纹理、着色器程序和每只眼的 dispatch，供 offscreen_main / stereogen_bench 复用
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "frame_graph.h"
+#include "rgbd_input.h"
+#include "texture_pool.h"
+
+// warp 变体
+enum class WarpVariant {
+    Scatter,     // warp.comp + warp_resolve.comp：单趟键竞争 + 按键回填
+    SplitPass,   // warp_depth.comp + warp_color.comp：两趟，深度取自 SBS 纹理右半
+    Gather,      // warp_gather.comp：每个目标像素在有界源窗口里反向查找胜者，无原子操作，输出与 Scatter 一致
+    SplitGather, // warp_gather_gl.comp：同上，输入（SBS）与输出与 SplitPass 一致
+    RowScatter,  // warp_row.comp：工作组负责一行 256 列 + 视差 apron，在共享内存里原子竞争后合并写出，
+                 // 没有全局原子操作，输出与 Scatter 一致
+    Mesh,        // warp_mesh.vert / .frag：每行源像素连成三角形带按深度位移后光栅化，硬件深度测试决定可见性，
+                 // 拉伸的四边形盖住空洞，fill 为空操作（输入同 Scatter，不支持 Splat）
+};
+
+// fill 变体
+enum class FillVariant {
+    TilePrefix, // fill_tile.comp + fill_prefix.comp：tile 内交替填充 + tile 间前缀传播
+    LogShift,   // fill_tile_gl.comp：tile 内双向对数步长传播
+};
+
+// 取色方式
+enum class ColorResolve {
+    Eager,    // warp 回填颜色，fill 同时搬运颜色和索引
+    Deferred,         // warp / fill 只处理索引，gather_color.comp 最后按索引从原图取色
+    DeferredBilinear, // 同上，按亚像素位置双线性取色（深度边缘和空洞填充处仍取最近像素）
+    Splat,            // 高质量：warp_splat.comp 按覆盖率把同表面源像素的颜色定点原子加到累加缓冲，
+                      // splat_normalize.comp 归一化后写颜色 / 索引（仅 Scatter）
+};
+
+// 着色器方言：Desktop 为 GLSL 430；GLES 读取 android_gles/shaders（仅 SplitPass + LogShift），改写为 430 后编译
+enum class ShaderDialect {
+    Desktop,
+    GLES,
+};
+
+// 深度归一化：每帧在 GPU 上统计有效深度（> 0）的范围，映射到 [1/64, 1] 后再算视差 / 竞争键
+enum class DepthNormalize {
+    None,       // 深度按 [0,1] 原样使用（默认）
+    MinMax,     // 按最小 / 最大值
+    Percentile, // 按百分位截取（1024 段直方图），两端的离群值钳到范围内
+};
+
+// 读回格式：RGBA 直接读回颜色纹理；其余由 pack_output.comp 在 GPU 上打包进缓冲对象，读回的字节数更少，
+// CPU 也不再逐像素重排
+enum class OutputFormat {
+    RGBA, // 4 B/px（默认，不打包）
+    RGB,  // 3 B/px，行紧密排列
+    BGRA, // 4 B/px
+    NV12, // Y 平面 + UV 交错平面（BT.601 有限范围，4:2:0），1.5 B/px
+    I420, // Y / U / V 三个平面
+};
+
+const char *variantName(WarpVariant warp);
+const char *variantName(FillVariant fill);
+const char *variantName(ColorResolve color);
+const char *variantName(DepthNormalize norm);
+const char *variantName(OutputFormat format);
+bool parseColorResolve(const std::string &name, ColorResolve &color);
+bool parseDepthNormalize(const std::string &name, DepthNormalize &norm);
+bool parseOutputFormat(const std::string &name, OutputFormat &format);
+// 一只眼按 format 读回的字节数（各平面首尾相接，宽 / 高为奇数时色度平面向上取整）
+size_t outputBytes(OutputFormat format, int width, int height);
+
+// 立体参数
+struct StereoParams {
+    float divergence = 2.0f;  // 视差，图像宽度的百分比
+    float convergence = 0.0f; // 汇聚深度
+};
+
+// GPU 统计的深度范围（readDepthRange 读回，调试 / 回归用）
+struct DepthRange {
+    float min = 0.0f, max = 0.0f;          // 有效深度（> 0、有限）的最小 / 最大值，没有有效深度时为 0
+    float lo = 0.0f, hi = 0.0f;            // 映射到 [1/64, 1] 的范围（MinMax 时等于 min / max）
+    float normLo = 0.0f, normScale = 1.0f; // warp 实际使用的参数：clamp((z - normLo) * normScale, 0, 1)
+};
+
+// SplitPass 竞争键诊断计数（setDepthBits(bits, true) 时累计）
+struct KeyStats {
+    uint32_t atomics = 0;   // warp_depth 的 imageAtomicMax 次数
+    uint32_t raises = 0;    // 其中抬高了最大值的次数（与调度顺序有关，反映写竞争）
+    uint32_t tieLosses = 0; // 深度部分与胜者相同、只因索引落败的候选数（量化精度不足的像素）
+};
+
+// fill barrier 诊断计数（setFillBound(bounded, true) 时累计，两眼合计）
+struct FillStats {
+    uint32_t workgroups = 0; // fill_tile 工作组数
+    uint32_t barriers = 0;   // 各工作组执行的 barrier 次数之和
+    uint32_t fallbacks = 0;  // 有界迭代后仍需补完剩余轮次 / 步长的趟数
+};
+
+// 单眼目标：RGBA8 颜色 / R32UI 索引（warp 写入，fill 读写，帧结束前一直有效）
+// 延迟取色时颜色只由最后的 gather 写入
+// 竞争键只在 warp 内有效、tile 边缘只在 fill 的两趟之间有效：默认每眼各一份，两眼的 pass 才能交错执行；
+// setInterleaveEyes(false) 时右眼与左眼共用同一份
+struct EyeTargets {
+    GLuint color = 0, index = 0;
+    GLuint key = 0;  // R32UI 竞争键（单趟 warp / Mesh 不需要）
+    GLuint edge = 0; // RGBA32UI tile 边缘（仅 TilePrefix）
+};
+
+// 列分块窗口（仅 columnTileable() 的变体：Scatter / Gather / RowScatter + TilePrefix，Eager 或 Splat 取色）：
+// 目标纹理只覆盖整幅中的一段列（含两侧 halo），位移、补边和竞争键位数仍按整幅宽度计算，
+// fill 的 tile 间传播从 carry 读入行首状态、扫描结束写回，逐块从左到右处理时与整幅处理逐位一致。
+// 延迟取色不支持：跨块传播的只有索引，它可能指向本块源窗口以外的列；
+// Mesh 也不支持：光栅化的顶点舍入与属性插值随窗口平移而变
+struct ColumnWindow {
+    int width = 0;      // 本块宽度（不超过 allocateTargets 的宽度）；0 表示不分块
+    int fullWidth = 0;  // 整幅宽度
+    int originX = 0;    // 本块第 0 列在整幅中的列号，须为 TILE_W 的倍数
+    int tileBegin = 0;  // 前缀传播扫描的 tile 区间 [tileBegin, tileEnd)
+    int tileEnd = 0;
+    GLuint carryLeft = 0, carryRight = 0; // RGBA32UI，1 x 高度
+};
+
+class StereoPipeline {
+public:
+    static const int TILE_W = 256; // 与 fill_tile*.comp 保持一致
+
+    // 编译所选变体的着色器，shaderDir 为空时从工作目录读取
+    bool loadPrograms(WarpVariant warp, FillVariant fill, const std::string &shaderDir = "",
+                      ShaderDialect dialect = ShaderDialect::Desktop, ColorResolve color = ColorResolve::Eager);
+    // SplitPass 竞争键的深度位数（8..16，其余低位放源列号），编译时以 #define DEPTH_BITS 注入
+    // warp_depth / warp_color；keyStats 为 true 时另注入 KEY_STATS 统计原子操作（仅桌面着色器）。
+    // 列号至少要 16 位才能容纳任意纹理宽度，超出范围时返回 false 并保持原设置。须在 loadPrograms 之前调用
+    bool setDepthBits(int bits, bool keyStats = false);
+    int depthBits() const { return depthBits_; }
+    // 读出并清零 KEY_STATS 计数；未开启统计时返回 false
+    bool readKeyStats(KeyStats &stats);
+    // fill 的 tile 内传播上限（默认开启）：空洞宽度不超过视差范围 |shiftScale|，按它算出 maxHole 传给 fill_tile*.comp，
+    // 只跑覆盖该宽度的迭代轮数 / 步长；超出估计的 tile 由着色器补完剩余部分，结果与不设上限逐位一致。
+    // fillStats 为 true 时注入 FILL_STATS 统计 barrier 次数（仅桌面着色器）。须在 loadPrograms 之前调用
+    void setFillBound(bool bounded, bool fillStats = false);
+    // 读出并清零 FILL_STATS 计数；未开启统计时返回 false
+    bool readFillStats(FillStats &stats);
+    // 两眼共用的视差预计算（默认关闭，仅 Scatter / SplitPass 的桌面着色器，其余变体忽略）：每帧先由 disparity.comp
+    // 把源深度（含归一化）解码一次写成 R32F，两眼的 warp 注入 SHARED_DISP 后读它算视差与竞争键，
+    // 不再各自解码深度（SplitPass 每帧四次）。输出逐位一致。shaderDir 为 disparity.comp 所在目录，
+    // 为空时与 loadPrograms 相同。须在 loadPrograms 之前调用
+    void setSharedDisparity(bool shared, const std::string &shaderDir = "");
+    bool sharedDisparity() const { return dispProg_ != 0; }
+    // 深度归一化（默认关闭，仅 Scatter / Gather / RowScatter / Mesh 的桌面着色器，SBS 输入的变体忽略）：
+    // 每帧 warp 前由 depth_range.comp 并行归约出深度范围（Percentile 另做直方图取 lowPercent / highPercent 百分位），
+    // 求解 pass 把参数写进 uniform 块供 warp 读取，整个过程不经 CPU 读回。须在 loadPrograms 之前调用
+    void setDepthNormalize(DepthNormalize mode, float lowPercent = 1.0f, float highPercent = 99.0f);
+    bool depthNormalized() const { return normalizeDepth_; }
+    // 读回最近一次统计的深度范围（会等待 GPU）；未开启归一化时返回 false
+    bool readDepthRange(DepthRange &range);
+    // 调试深度图：在 GPU 上按归一化参数写成 8 位灰度后读回（width x height，行紧密排列），
+    // 代替读回整幅 R32F 再在 CPU 上求 min / max。开启归一化时沿用最近一次 warp 的范围，否则先按 min / max 统计一次
+    bool readDepthPreview(std::vector<uint8_t> &gray);
+    // 读回格式（默认 RGBA）：非 RGBA 时 fill / fillEye 末尾每眼加一个打包 pass，把最终颜色写进缓冲对象。
+    // 须在 loadPrograms 之后调用（此时编译对应的打包着色器），编译失败返回 false。
+    // shaderDir 为 pack_output.comp 所在目录（源码树中在根目录），为空时与 loadPrograms 相同
+    bool setOutputFormat(OutputFormat format, const std::string &shaderDir = "");
+    OutputFormat outputFormat() const { return outputFormat_; }
+    // 把最近一次 fill 的结果按 outputFormat 读回到 left / right（各 outputBytes 字节，为空的一侧跳过），会等待 GPU
+    bool readOutput(void *left, void *right);
+    // 同上，但在 GPU 上把打包结果复制进调用方的缓冲对象（各至少 outputBytes 字节），不等待，供异步读回；
+    // outputFormat 为 RGBA 时没有打包缓冲，返回 false
+    bool copyOutput(GLuint left, GLuint right);
+    // 两眼交错执行（默认开启）：竞争键 / tile 边缘每眼各一份，同级的两眼 pass 排进帧图同一层、共用 barrier，
+    // 代价是多一份竞争键（w*h*4 字节）和 edge。关闭时两眼共用一份，帧图按共用纹理上的冲突把右眼排在左眼之后，
+    // barrier 随之增多，适合显存受限的场合。须在 allocateTargets 之前调用
+    void setInterleaveEyes(bool interleave) { interleaveEyes_ = interleave; }
+    // 为左右眼分配 width x height 的目标纹理并初始化；纹理取自池，旧尺寸的纹理归还到池
+    void allocateTargets(int width, int height);
+    // 目标纹理的显存（两眼各自的颜色 / 索引、每眼或共用的竞争键 / edge + 共用的 splat 累加缓冲 / 视差纹理 / 网格深度缓冲），
+    // 与 allocateTargets 的分配一致：单趟 warp 与 Mesh 不分配竞争键，Mesh 不分配 edge
+    static size_t targetBytes(int width, int height, WarpVariant warp = WarpVariant::Scatter,
+                              FillVariant fill = FillVariant::TilePrefix, ColorResolve color = ColorResolve::Eager,
+                              bool sharedDisparity = false, bool interleaveEyes = true);
+    // 池中保留的空闲纹理上限（默认 0：尺寸变化时旧纹理立即释放）
+    void setPoolLimit(size_t bytes) { poolLimit_ = bytes; }
+    const TexturePool &texturePool() const { return pool_; }
+    // 输入纹理：Scatter / Gather 用 RGB 颜色 + R32F 深度；
+    // SplitPass / SplitGather 用 SBS 纹理（左半颜色、右半 R 通道深度），depthTex 被忽略。
+    // 缺少所选变体需要的纹理时返回 false，之后的 warp 不可用
+    bool setSource(GLuint colorTex, GLuint depthTex);
+    // 打包输入：Scatter 按 depthOffset / encoding 从同一纹理读深度；
+    // SplitPass / SplitGather 只支持 SBS + R8（着色器固定读右半 R 通道），其余输入返回 false
+    bool setSource(const RGBDInput &input);
+    void setParams(const StereoParams &params) { params_ = params; }
+    // 设置 / 清除（传默认值）列分块窗口，须在 allocateTargets 之后调用
+    void setColumnWindow(const ColumnWindow &window);
+
+    // 单眼：只含这只眼的 pass
+    void warpEye(EyeTargets &eye, int eyeSign);
+    void fillEye(EyeTargets &eye, int eyeSign);
+    // 左眼 +1、右眼 -1：两眼的 pass 放进同一张帧图，按依赖分层交错提交，barrier 由帧图推导
+    void warp();
+    void fill();
+    // 最近一次 warp / fill 的调度（每层的 pass、声明的资源与层前的 barrier）
+    void dumpSchedule(std::ostream &os) const;
+    int barriersPerFrame() const { return warpGraph_.barrierCount() + fillGraph_.barrierCount(); }
+    // 为下一帧复位：竞争键在每眼 warp 前清零，这里只有 SplitPass 需要把索引置为未定义
+    void resetTargets();
+    void release();
+
+    int width() const { return width_; }
+    // 能否按行条带处理（StripeStreamer），结果与整幅逐位一致；取色方式不限
+    bool streamable() const {
+        return (warpVariant_ == WarpVariant::Scatter || warpVariant_ == WarpVariant::Gather ||
+                warpVariant_ == WarpVariant::RowScatter) && fillVariant_ == FillVariant::TilePrefix;
+    }
+    // 能否再按列分块（ColumnWindow）
+    bool columnTileable() const { return streamable() && !deferred(); }
+    int height() const { return height_; }
+    // 位移与补边按整幅宽度计算（列分块时不是目标纹理宽度）
+    int referenceWidth() const { return window_.width > 0 ? window_.fullWidth : width_; }
+    int padSize() const { return padSizeFor(referenceWidth()); }
+    int padSizeFor(int width) const { return padSizeOf(params_, width); }
+
+    // 与参数 / 宽度有关的算式，FrameBatch 按层复用，保证批处理与逐帧逐位一致（width 为整幅宽度）
+    // 竞争键低位的位数：容纳 srcX+1（至少 8 位）
+    static int keyIndexBits(int width);
+    // 一只眼（左眼 +1、右眼 -1）的水平位移系数，位移 = 深度 * shiftScale - convergence * shiftScale
+    static float shiftScaleOf(const StereoParams &params, int width, int eyeSign) {
+        return params.divergence * 0.01f * width * 0.5f * eyeSign;
+    }
+    // fill 传播上限：最大视差差加上投射取整的 2 列
+    static int maxHoleOf(float shiftScale);
+    // warp 两侧的补边宽度
+    static int padSizeOf(const StereoParams &params, int width) { return int(width * params.divergence * 0.01f + 2); }
+    // 读深度的着色器共用的解码片段（shaderDir 下的 depth_decode.glsl），随 #define 一起插在 #version 之后
+    static std::string depthDecodeSource(const std::string &shaderDir);
+
+    EyeTargets left, right;
+
+private:
+    void releaseTargets();
+    void addDisparityPass(FrameGraph &graph);
+    bool loadRangePrograms();
+    // 统计深度范围并写出归一化参数；状态缓冲由求解 pass 复位，留给下一帧
+    void addDepthRangePasses(FrameGraph &graph, bool percentile);
+    // warp 各 pass 经 uniform 块读取归一化参数（未开启时为空资源）
+    ResourceUse depthNormUse() const;
+    void addWarpPasses(FrameGraph &graph, const EyeTargets &eye, int eyeSign);
+    void addFillPasses(FrameGraph &graph, const EyeTargets &eye, int eyeSign);
+    void addGatherPass(FrameGraph &graph, const EyeTargets &eye, int eyeSign);
+    void addWarpOutputs(FrameGraph &graph, const EyeTargets &eye, int eyeSign);
+    void addFillOutputs(FrameGraph &graph, const EyeTargets &eye, int eyeSign);
+    void ensurePackBuffers();
+    void addPackPass(FrameGraph &graph, const EyeTargets &eye, int eyeSign);
+    void bindSource() const; // 纹理单元 0 / 1 / 2：源颜色 / 深度 / 共用视差，uniform 块 0：深度归一化参数
+    void setWarpUniforms(GLuint prog, int eyeSign) const;
+    void setSplitUniforms(GLuint prog, int eyeSign) const;
+    // SplitPass / SplitGather：OpenGLStereoGenerator 着色器，SBS 输入，索引为 srcY*宽+srcX
+    bool sbsInput() const { return warpVariant_ == WarpVariant::SplitPass || warpVariant_ == WarpVariant::SplitGather; }
+    // 单趟直接写颜色 / 索引，不需要竞争键纹理
+    bool singlePassWarp() const {
+        return warpVariant_ == WarpVariant::Gather || warpVariant_ == WarpVariant::SplitGather ||
+               warpVariant_ == WarpVariant::RowScatter;
+    }
+    bool meshWarp() const { return warpVariant_ == WarpVariant::Mesh; }
+    bool deferred() const {
+        return colorResolve_ == ColorResolve::Deferred || colorResolve_ == ColorResolve::DeferredBilinear;
+    }
+    float shiftScaleFor(int eyeSign) const { return shiftScaleOf(params_, referenceWidth(), eyeSign); }
+    // 0 表示不设上限
+    int maxHoleFor(int eyeSign) const { return fillBound_ ? maxHoleOf(shiftScaleFor(eyeSign)) : 0; }
+
+    WarpVariant warpVariant_ = WarpVariant::Scatter;
+    FillVariant fillVariant_ = FillVariant::TilePrefix;
+    StereoParams params_;
+
+    GLuint warpProg_ = 0;    // warp.comp / warp_depth.comp / warp_gather*.comp / warp_row.comp / warp_mesh（图形程序）
+    GLuint resolveProg_ = 0; // warp_resolve.comp / warp_color.comp
+    GLuint tileProg_ = 0;    // fill_tile.comp / fill_tile_gl.comp
+    GLuint prefixProg_ = 0;  // fill_prefix.comp（仅 TilePrefix）
+    GLuint gatherProg_ = 0;  // gather_color.comp（仅延迟取色）
+    GLuint splatProg_ = 0;   // warp_splat.comp（仅 Splat，resolveProg_ 为 splat_normalize.comp）
+    GLuint dispProg_ = 0;    // disparity.comp（仅共用视差）
+    int depthBits_ = 16;     // SplitPass 竞争键深度位数
+    bool keyStats_ = false;
+    GLuint statsBuf_ = 0;    // KEY_STATS 计数（3 x uint）
+    bool fillBound_ = true;
+    bool fillStats_ = false;
+    GLuint fillStatsBuf_ = 0; // FILL_STATS 计数（3 x uint）
+    bool sharedDisp_ = false;
+    bool interleaveEyes_ = true; // false：右眼的竞争键 / edge 与左眼共用
+    std::string dispShaderDir_;
+    DepthNormalize depthNorm_ = DepthNormalize::None;
+    float lowPercent_ = 1.0f, highPercent_ = 99.0f;
+    bool normalizeDepth_ = false;   // warp 着色器注入了 DEPTH_NORM
+    std::string shaderDir_;
+    GLuint rangeProgs_[4] = {0, 0, 0, 0}; // depth_range.comp：min / max、直方图、求解、灰度图
+    GLuint rangeBuf_ = 0;           // 统计状态（min / max 位模式 + 直方图），求解 pass 读完即复位
+    GLuint normBuf_ = 0;            // 归一化参数（warp 的 uniform 块 DepthNorm）+ 统计结果
+    OutputFormat outputFormat_ = OutputFormat::RGBA;
+    GLuint packProgs_[5] = {0, 0, 0, 0, 0}; // pack_output.comp，按 OutputFormat 编号（RGBA 不需要）
+    ColorResolve colorResolve_ = ColorResolve::Eager;
+
+    TexturePool pool_;
+    size_t poolLimit_ = 0;
+    GLuint accumBuf_ = 0; // splat 累加缓冲（每像素 4 x uint），两眼共用，归一化时清零（仅 Splat）
+    GLuint dispTex_ = 0;  // R32F 共用的解码深度（源尺寸），每帧 warp 前重写（仅共用视差）
+    GLuint meshDepth_ = 0; // DEPTH_COMPONENT32F 深度缓冲，两眼共用，每眼绘制前清零（仅 Mesh）
+    GLuint packBuf_[2] = {0, 0}; // 左 / 右眼的打包输出（仅非 RGBA 读回格式），按当前尺寸与格式分配
+    size_t packBytes_ = 0;
+    GLuint meshFbo_ = 0, meshVao_ = 0; // 绘制目标（每眼挂接颜色 / 索引）与空 VAO（顶点由 gl_VertexID 生成）
+    FrameGraph warpGraph_, fillGraph_;  // 每次 warp / fill 重建，保留到下一次供 dumpSchedule
+
+    GLuint srcColor_ = 0, srcDepth_ = 0;
+    int depthOffsetX_ = 0, depthOffsetY_ = 0;
+    DepthEncoding depthEncoding_ = DepthEncoding::Float;
+    int width_ = 0, height_ = 0;
+    int allocWidth_ = 0;
+    int numTile_ = 0;
+    int idxBits_ = 8;
+    ColumnWindow window_;
+};
@@ -0,0 +1,290 @@
+#include "stereogen.h"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gl_utils.h"
+#include "stereo_pipeline.h"
+#include "trace.h"
+
+#ifndef _WIN32
+#include "shared_memory.h"
+#endif
+
+struct StereogenContext {
+    StereoPipeline pipeline;
+    StereoParams params;
+
+    // 源纹理按尺寸 / 格式复用
+    GLuint colorTex = 0, depthTex = 0;
+    int srcW = 0, srcH = 0;
+    StereogenColorFormat srcFormat = STEREOGEN_COLOR_RGB8;
+
+    // 两个解包缓冲轮换，上一帧的 DMA 未完成时也不必等待
+    GLuint unpack[2] = {0, 0};
+    int nextUnpack = 0;
+
+    std::vector<uint8_t> scratch; // 输出跨度不是像素大小整数倍（或打包输出带跨度）时的中转
+    std::string error;
+};
+
+namespace {
+
+int colorBytes(StereogenColorFormat format) {
+    return format == STEREOGEN_COLOR_RGBA8 || format == STEREOGEN_COLOR_BGRA8 ? 4 : 3;
+}
+
+bool inputFormat(StereogenColorFormat format) {
+    return format == STEREOGEN_COLOR_RGB8 || format == STEREOGEN_COLOR_RGBA8;
+}
+
+bool planarFormat(StereogenColorFormat format) {
+    return format == STEREOGEN_COLOR_NV12 || format == STEREOGEN_COLOR_I420;
+}
+
+OutputFormat packFormat(StereogenColorFormat format) {
+    switch (format) {
+    case STEREOGEN_COLOR_RGB8: return OutputFormat::RGB;
+    case STEREOGEN_COLOR_BGRA8: return OutputFormat::BGRA;
+    case STEREOGEN_COLOR_NV12: return OutputFormat::NV12;
+    case STEREOGEN_COLOR_I420: return OutputFormat::I420;
+    default: return OutputFormat::RGBA;
+    }
+}
+
+int depthBytes(StereogenDepthFormat format) {
+    return format == STEREOGEN_DEPTH_UINT16 ? 2 : 4;
+}
+
+int fail(StereogenContext *ctx, int status, const char *message) {
+    ctx->error = message;
+    return status;
+}
+
+GLuint createTexture(GLenum internalFormat, int width, int height) {
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return tex;
+}
+
+void ensureSourceTextures(StereogenContext *ctx, int width, int height, StereogenColorFormat format) {
+    if (ctx->colorTex && ctx->srcW == width && ctx->srcH == height && ctx->srcFormat == format) return;
+    if (ctx->colorTex) glDeleteTextures(1, &ctx->colorTex);
+    if (ctx->depthTex) glDeleteTextures(1, &ctx->depthTex);
+    ctx->colorTex = createTexture(format == STEREOGEN_COLOR_RGBA8 ? GL_RGBA8 : GL_RGB8, width, height);
+    ctx->depthTex = createTexture(GL_R32F, width, height);
+    ctx->srcW = width;
+    ctx->srcH = height;
+    ctx->srcFormat = format;
+}
+
+// 逐行拷入解包缓冲（去掉跨度），再由驱动从缓冲异步传到纹理；映射失败时返回 false，纹理保持上一帧的内容
+bool uploadPlane(StereogenContext *ctx, GLuint tex, const void *src, size_t stride, int width, int height,
+                 int bytesPerPixel, GLenum format, GLenum type) {
+    size_t rowBytes = size_t(width) * bytesPerPixel;
+    size_t size = rowBytes * height;
+
+    GLuint pbo = ctx->unpack[ctx->nextUnpack];
+    ctx->nextUnpack ^= 1;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(size), nullptr, GL_STREAM_DRAW); // 孤立旧存储
+    auto *dst = static_cast<uint8_t *>(
+        glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(size), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    if (!dst) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return false;
+    }
+    const auto *row = static_cast<const uint8_t *>(src);
+    if (stride == rowBytes) {
+        std::memcpy(dst, row, size);
+    } else {
+        for (int y = 0; y < height; ++y)
+            std::memcpy(dst + y * rowBytes, row + y * stride, rowBytes);
+    }
+    bool ok = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+    if (ok) {
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, type, nullptr);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return ok;
+}
+
+// 跨度是像素大小的整数倍时用 GL_PACK_ROW_LENGTH 直接写入，否则经中转逐行拷贝
+void readbackEye(StereogenContext *ctx, GLuint tex, void *dst, size_t stride, int width, int height,
+                 StereogenColorFormat format) {
+    int bpp = colorBytes(format);
+    GLenum glFormat = format == STEREOGEN_COLOR_RGBA8 ? GL_RGBA : GL_RGB;
+    size_t rowBytes = size_t(width) * bpp;
+
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    if (stride % bpp == 0) {
+        glPixelStorei(GL_PACK_ROW_LENGTH, GLint(stride / bpp));
+        glGetTexImage(GL_TEXTURE_2D, 0, glFormat, GL_UNSIGNED_BYTE, dst);
+        glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+        return;
+    }
+    ctx->scratch.resize(rowBytes * height);
+    glGetTexImage(GL_TEXTURE_2D, 0, glFormat, GL_UNSIGNED_BYTE, ctx->scratch.data());
+    for (int y = 0; y < height; ++y)
+        std::memcpy(static_cast<uint8_t *>(dst) + y * stride, ctx->scratch.data() + y * rowBytes, rowBytes);
+}
+
+// fill 已把两眼打包进缓冲对象；行紧密排列时直接读进调用方内存，否则经中转逐行拷贝
+void readbackPacked(StereogenContext *ctx, void *left, void *right, size_t stride, size_t rowBytes, int height) {
+    if (stride == rowBytes) {
+        ctx->pipeline.readOutput(left, right);
+        return;
+    }
+    ctx->scratch.resize(rowBytes * height);
+    void *dst[2] = {left, right};
+    for (int eye = 0; eye < 2; ++eye) {
+        uint8_t *tmp = ctx->scratch.data();
+        ctx->pipeline.readOutput(eye == 0 ? tmp : nullptr, eye == 1 ? tmp : nullptr);
+        for (int y = 0; y < height; ++y)
+            std::memcpy(static_cast<uint8_t *>(dst[eye]) + y * stride, tmp + y * rowBytes, rowBytes);
+    }
+}
+
+} // namespace
+
+StereogenContext *stereogen_create(const char *shaderDir) {
+    if (!createOffscreenContext(false)) return nullptr;
+
+    auto *ctx = new StereogenContext;
+    if (!ctx->pipeline.loadPrograms(WarpVariant::Scatter, FillVariant::TilePrefix, shaderDir ? shaderDir : "")) {
+        delete ctx;
+        glfwTerminate();
+        return nullptr;
+    }
+    glGenBuffers(2, ctx->unpack);
+    return ctx;
+}
+
+void stereogen_destroy(StereogenContext *ctx) {
+    if (!ctx) return;
+    ctx->pipeline.release();
+    if (ctx->colorTex) glDeleteTextures(1, &ctx->colorTex);
+    if (ctx->depthTex) glDeleteTextures(1, &ctx->depthTex);
+    glDeleteBuffers(2, ctx->unpack);
+    delete ctx;
+    glfwTerminate();
+}
+
+void stereogen_set_params(StereogenContext *ctx, float divergence, float convergence) {
+    ctx->params.divergence = divergence;
+    ctx->params.convergence = convergence;
+}
+
+int stereogen_convert(StereogenContext *ctx, const StereogenFrame *frame, const StereogenOutput *out) {
+    if (!ctx) return STEREOGEN_ERROR_INVALID_ARGUMENT;
+    if (!frame || !out || !frame->color || !frame->depth || !out->left || !out->right)
+        return fail(ctx, STEREOGEN_ERROR_INVALID_ARGUMENT, "null frame or output buffer");
+    const int w = frame->width, h = frame->height;
+    if (w <= 0 || h <= 0) return fail(ctx, STEREOGEN_ERROR_INVALID_ARGUMENT, "bad frame size");
+    if (!inputFormat(frame->colorFormat))
+        return fail(ctx, STEREOGEN_ERROR_INVALID_ARGUMENT, "input color must be RGB8 or RGBA8");
+    if (out->format < STEREOGEN_COLOR_RGB8 || out->format > STEREOGEN_COLOR_I420)
+        return fail(ctx, STEREOGEN_ERROR_INVALID_ARGUMENT, "unknown output color format");
+    if (planarFormat(out->format) && out->stride)
+        return fail(ctx, STEREOGEN_ERROR_INVALID_ARGUMENT, "planar output needs stride 0");
+    if (!ctx->pipeline.setOutputFormat(packFormat(out->format)))
+        return fail(ctx, STEREOGEN_ERROR_GL, "cannot compile the output packing shader");
+
+    size_t colorRow = size_t(w) * colorBytes(frame->colorFormat);
+    size_t depthRow = size_t(w) * depthBytes(frame->depthFormat);
+    size_t outRow = planarFormat(out->format) ? size_t(w) : size_t(w) * colorBytes(out->format);
+    size_t colorStride = frame->colorStride ? frame->colorStride : colorRow;
+    size_t depthStride = frame->depthStride ? frame->depthStride : depthRow;
+    size_t outStride = out->stride ? out->stride : outRow;
+    if (colorStride < colorRow || depthStride < depthRow || outStride < outRow)
+        return fail(ctx, STEREOGEN_ERROR_INVALID_ARGUMENT, "stride smaller than a row");
+
+    TRACE_SCOPE("stereogen_convert");
+    ensureSourceTextures(ctx, w, h, frame->colorFormat);
+    {
+        TRACE_SCOPE("upload");
+        TRACE_GPU_SCOPE("upload");
+        bool rgba = frame->colorFormat == STEREOGEN_COLOR_RGBA8;
+        // uint16 作为归一化定点上传到 R32F，GL 自动换算为 d / 65535
+        bool u16 = frame->depthFormat == STEREOGEN_DEPTH_UINT16;
+        if (!uploadPlane(ctx, ctx->colorTex, frame->color, colorStride, w, h, colorBytes(frame->colorFormat),
+                         rgba ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE) ||
+            !uploadPlane(ctx, ctx->depthTex, frame->depth, depthStride, w, h, depthBytes(frame->depthFormat), GL_RED,
+                         u16 ? GL_UNSIGNED_SHORT : GL_FLOAT))
+            return fail(ctx, STEREOGEN_ERROR_GL, "cannot map the upload buffer");
+    }
+
+    StereoPipeline &pipeline = ctx->pipeline;
+    if (pipeline.width() != w || pipeline.height() != h) {
+        pipeline.allocateTargets(w, h);
+    } else {
+        pipeline.resetTargets();
+    }
+    if (!pipeline.setSource(ctx->colorTex, ctx->depthTex))
+        return fail(ctx, STEREOGEN_ERROR_GL, "input textures do not match the warp variant");
+    pipeline.setParams(ctx->params);
+    pipeline.warp();
+    pipeline.fill();
+
+    {
+        TRACE_SCOPE("readback");
+        if (out->format == STEREOGEN_COLOR_RGBA8) {
+            readbackEye(ctx, pipeline.left.color, out->left, outStride, w, h, out->format);
+            readbackEye(ctx, pipeline.right.color, out->right, outStride, w, h, out->format);
+        } else {
+            readbackPacked(ctx, out->left, out->right, outStride, outRow, h);
+        }
+    }
+    if (glGetError() != GL_NO_ERROR) return fail(ctx, STEREOGEN_ERROR_GL, "OpenGL error during conversion");
+    ctx->error.clear();
+    return STEREOGEN_OK;
+}
+
+int stereogen_convert_fd(StereogenContext *ctx, int fd, size_t colorOffset, size_t depthOffset,
+                         const StereogenFrame *frame, const StereogenOutput *out) {
+    if (!ctx) return STEREOGEN_ERROR_INVALID_ARGUMENT;
+    if (!frame || frame->width <= 0 || frame->height <= 0)
+        return fail(ctx, STEREOGEN_ERROR_INVALID_ARGUMENT, "bad frame size");
+#ifdef _WIN32
+    (void)fd;
+    (void)colorOffset;
+    (void)depthOffset;
+    (void)out;
+    return fail(ctx, STEREOGEN_ERROR_MAP, "file descriptors are not supported on this platform");
+#else
+    size_t colorStride = frame->colorStride ? frame->colorStride : size_t(frame->width) * colorBytes(frame->colorFormat);
+    size_t depthStride = frame->depthStride ? frame->depthStride : size_t(frame->width) * depthBytes(frame->depthFormat);
+    // 最后一行只需一行的像素，不要求跨度补齐
+    size_t colorEnd = colorOffset + colorStride * (frame->height - 1) + size_t(frame->width) * colorBytes(frame->colorFormat);
+    size_t depthEnd = depthOffset + depthStride * (frame->height - 1) + size_t(frame->width) * depthBytes(frame->depthFormat);
+
+    // 颜色与深度一次映射覆盖
+    size_t begin = std::min(colorOffset, depthOffset);
+    size_t end = std::max(colorEnd, depthEnd);
+    SharedMemory mapping;
+    if (!mapping.map(fd, end - begin, begin, false))
+        return fail(ctx, STEREOGEN_ERROR_MAP, "cannot map file descriptor");
+
+    StereogenFrame mapped = *frame;
+    mapped.color = mapping.data() + (colorOffset - begin);
+    mapped.depth = mapping.data() + (depthOffset - begin);
+    mapped.colorStride = colorStride;
+    mapped.depthStride = depthStride;
+    return stereogen_convert(ctx, &mapped, out);
+#endif
+}
+
+const char *stereogen_last_error(const StereogenContext *ctx) {
+    return ctx ? ctx->error.c_str() : "null context";
+}
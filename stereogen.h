@@ -0,0 +1,87 @@
+#ifndef STEREOGEN_H
+#define STEREOGEN_H
+/*
+ * stereogen C API：在调用方内存之间直接交换帧数据，不经过 PNG / EXR 编解码，也不读写帧文件
+ *
+ * 输入为调用方持有的 RGB8 / RGBA8 颜色与 float32 / uint16 深度（各自带行跨度），
+ * 经像素解包缓冲（GL_PIXEL_UNPACK_BUFFER）上传；也可以传 POSIX shm / memfd 描述符，库内只读映射。
+ * 左右眼结果直接读回到调用方提供的输出缓冲。
+ *
+ * 上下文在 stereogen_create 的线程上创建并绑定，之后所有调用须在同一线程；同一时间只支持一个上下文。
+ * 着色器只在 stereogen_create 时从 shaderDir 读取一次。
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct StereogenContext StereogenContext;
+
+typedef enum {
+    STEREOGEN_OK = 0,
+    STEREOGEN_ERROR_INVALID_ARGUMENT = -1,
+    STEREOGEN_ERROR_MAP = -2, /* 描述符映射失败或过小 */
+    STEREOGEN_ERROR_GL = -3,
+} StereogenStatus;
+
+/*
+ * 输入只支持 RGB8 / RGBA8。输出的 RGB8 / BGRA8 / NV12 / I420 在 GPU 上打包后读回（RGBA8 直接读回）；
+ * NV12 / I420 为 BT.601 有限范围 4:2:0，各平面紧密排列、依次相接（Y 在前，宽 / 高为奇数时色度向上取整），stride 须为 0
+ */
+typedef enum {
+    STEREOGEN_COLOR_RGB8 = 0,
+    STEREOGEN_COLOR_RGBA8 = 1,
+    STEREOGEN_COLOR_BGRA8 = 2, /* 仅输出 */
+    STEREOGEN_COLOR_NV12 = 3,  /* 仅输出 */
+    STEREOGEN_COLOR_I420 = 4,  /* 仅输出 */
+} StereogenColorFormat;
+
+/* 深度约定与 depth.exr 相同：0..1，越大越近；uint16 按 d / 65535 换算 */
+typedef enum {
+    STEREOGEN_DEPTH_FLOAT32 = 0,
+    STEREOGEN_DEPTH_UINT16 = 1,
+} StereogenDepthFormat;
+
+typedef struct {
+    int width, height;
+    const void *color;
+    size_t colorStride; /* 字节；0 表示行紧密排列 */
+    StereogenColorFormat colorFormat;
+    const void *depth;
+    size_t depthStride;
+    StereogenDepthFormat depthFormat;
+} StereogenFrame;
+
+typedef struct {
+    void *left, *right; /* 各 height 行 */
+    size_t stride;      /* 字节；0 表示行紧密排列 */
+    StereogenColorFormat format;
+} StereogenOutput;
+
+/* shaderDir 为 NULL 或空串时从工作目录读取着色器；失败返回 NULL */
+StereogenContext *stereogen_create(const char *shaderDir);
+void stereogen_destroy(StereogenContext *ctx);
+
+/* divergence 为图像宽度的百分比（默认 2），convergence 为汇聚深度（默认 0） */
+void stereogen_set_params(StereogenContext *ctx, float divergence, float convergence);
+
+int stereogen_convert(StereogenContext *ctx, const StereogenFrame *frame, const StereogenOutput *out);
+
+/*
+ * 从描述符读取输入：frame 的 color / depth 指针被忽略，改用 fd 内的字节偏移。
+ * 仅 UNIX；其他平台返回 STEREOGEN_ERROR_MAP
+ */
+int stereogen_convert_fd(StereogenContext *ctx, int fd, size_t colorOffset, size_t depthOffset,
+                         const StereogenFrame *frame, const StereogenOutput *out);
+
+/* 最近一次失败的原因，成功后为空串 */
+const char *stereogen_last_error(const StereogenContext *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STEREOGEN_H */
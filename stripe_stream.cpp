@@ -0,0 +1,269 @@
+#include "stripe_stream.h"
+#include "gl_utils.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+
+GLLimits queryGLLimits() {
+    GLLimits limits;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &limits.maxTextureSize);
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &limits.maxWorkGroupCount[0]);
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 1, &limits.maxWorkGroupCount[1]);
+    return limits;
+}
+
+// 宽度是否放得进一张纹理、一次 dispatch（warp 按补边后的宽度 / 16 分组，补边按不超过半幅估计）
+static bool widthFits(const GLLimits &limits, int width) {
+    int numTile = (width + StereoPipeline::TILE_W - 1) / StereoPipeline::TILE_W;
+    return width <= limits.maxTextureSize && numTile <= limits.maxWorkGroupCount[0] &&
+           (2 * width + 15) / 16 <= limits.maxWorkGroupCount[0];
+}
+
+size_t StripeStreamer::bytesPerRow(int width, ColorResolve color, WarpVariant warp, bool interleaveEyes) {
+    size_t w = size_t(width);
+    size_t targets = StereoPipeline::targetBytes(width, 1, warp, FillVariant::TilePrefix, color, false, interleaveEyes);
+    size_t sources = 2 * (TexturePool::textureBytes(GL_RGB8, width, 1) + TexturePool::textureBytes(GL_R32F, width, 1));
+    size_t buffers = 2 * (w * (3 + 4) + 2 * w * 3) + 2 * w * 3; // 两个槽位的解包 + 左右读回，流水线两眼的打包缓冲
+    return targets + sources + buffers;
+}
+
+int StripeStreamer::chooseRows(int width, int height, int requested, size_t budgetBytes, ColorResolve color,
+                               WarpVariant warp, bool interleaveEyes) {
+    GLLimits limits = queryGLLimits();
+    if (!widthFits(limits, width)) return 0;
+
+    // fill 每行一个工作组：条带高度同时受纹理高度和 y 方向工作组数限制
+    int limit = std::min(limits.maxTextureSize, limits.maxWorkGroupCount[1]);
+    if (budgetBytes > 0) limit = int(std::min<size_t>(size_t(limit), budgetBytes / bytesPerRow(width, color, warp, interleaveEyes)));
+    int rows = requested > 0 ? std::min(requested, limit) : limit;
+    return std::min(rows, height);
+}
+
+VramPlan planVram(int width, int height, size_t budgetBytes, bool canStripe, ColorResolve color, WarpVariant warp,
+                  bool interleaveEyes) {
+    VramPlan plan;
+    plan.targetBytes =
+        StereoPipeline::targetBytes(width, height, warp, FillVariant::TilePrefix, color, false, interleaveEyes);
+    plan.sourceBytes = TexturePool::textureBytes(GL_RGB8, width, height) + TexturePool::textureBytes(GL_R32F, width, height);
+    if (budgetBytes == 0 || plan.frameBytes() <= budgetBytes) return plan;
+
+    plan.fits = false;
+    if (!canStripe) return plan;
+    int rows = StripeStreamer::chooseRows(width, height, 0, budgetBytes, color, warp, interleaveEyes);
+    if (rows <= 0) return plan;
+    plan.stripeRows = rows;
+    plan.stripeBytes = StripeStreamer::bytesPerRow(width, color, warp, interleaveEyes) * size_t(rows);
+    plan.fits = true;
+    return plan;
+}
+
+void printVramPlan(std::ostream &os, const VramPlan &plan, int width, int height, size_t budgetBytes) {
+    auto mib = [](size_t bytes) { return double(bytes) / (1024.0 * 1024.0); };
+    os << std::fixed << std::setprecision(1) << "VRAM plan " << width << "x" << height << ": targets "
+       << mib(plan.targetBytes) << " MiB + sources " << mib(plan.sourceBytes) << " MiB = " << mib(plan.frameBytes())
+       << " MiB";
+    if (budgetBytes > 0) os << ", budget " << mib(budgetBytes) << " MiB";
+    if (plan.stripeRows > 0)
+        os << " -> " << plan.stripeRows << "-row stripes, peak " << mib(plan.stripeBytes) << " MiB";
+    else if (!plan.fits)
+        os << " -> exceeds budget";
+    os << std::defaultfloat << std::endl;
+}
+
+int StripeStreamer::chooseTileCols(int width, int halo, int requested) {
+    const int tile = StereoPipeline::TILE_W;
+    GLLimits limits = queryGLLimits();
+    if (requested <= 0 && widthFits(limits, width)) return 0;
+
+    int cols = (limits.maxTextureSize - 2 * halo) / tile * tile;
+    while (cols > 0 && !widthFits(limits, cols + 2 * halo))
+        cols -= tile;
+    if (requested > 0) cols = std::min(cols, std::max(tile, requested / tile * tile));
+    return cols > 0 ? cols : -1;
+}
+
+int StripeStreamer::haloFor(const StereoPipeline &pipeline, int width) {
+    const int tile = StereoPipeline::TILE_W;
+    return (pipeline.padSizeFor(width) + tile - 1) / tile * tile;
+}
+
+int StripeStreamer::blockWidth(int width, int tileCols, int halo) {
+    return tileCols > 0 ? std::min(width, tileCols + 2 * halo) : width;
+}
+
+bool StripeStreamer::begin(StereoPipeline &pipeline, int width, int stripeRows, int tileCols) {
+    release();
+    if (!pipeline.streamable()) {
+        std::cerr << "Stripe / tile streaming needs a scatter, gather or row warp with tile_prefix fill" << std::endl;
+        return false;
+    }
+    if (tileCols > 0 && tileCols < width && !pipeline.columnTileable()) {
+        std::cerr << "Column tiles do not support deferred color" << std::endl;
+        return false;
+    }
+    pipeline_ = &pipeline;
+    width_ = width;
+    rows_ = stripeRows;
+    tileCols_ = tileCols > 0 && tileCols < width ? tileCols : 0;
+    halo_ = tileCols_ ? haloFor(pipeline, width) : 0;
+    texWidth_ = blockWidth(width, tileCols_, halo_);
+    pipeline.allocateTargets(texWidth_, stripeRows);
+
+    auto makeTexture = [&](GLenum format, int w) {
+        GLuint tex;
+        glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glTexStorage2D(GL_TEXTURE_2D, 1, format, w, stripeRows);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return tex;
+    };
+    for (Slot &slot : slots_) {
+        slot.color = makeTexture(GL_RGB8, texWidth_);
+        slot.depth = makeTexture(GL_R32F, texWidth_);
+        glGenBuffers(1, &slot.unpack);
+        glGenBuffers(2, slot.pack);
+        for (GLuint pack : slot.pack) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pack);
+            glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(size_t(texWidth_) * stripeRows * 3), nullptr,
+                         GL_STREAM_READ);
+        }
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (tileCols_) {
+        carry_[0] = makeTexture(GL_RGBA32UI, 1);
+        carry_[1] = makeTexture(GL_RGBA32UI, 1);
+    }
+    return true;
+}
+
+void StripeStreamer::upload(Slot &slot, const uint8_t *rgb, const float *depth) {
+    TRACE_SCOPE("upload block");
+    TRACE_GPU_SCOPE("upload block");
+    const int w = slot.sx1 - slot.sx0;
+    size_t colorBytes = size_t(w) * slot.rows * 3;
+    size_t depthBytes = size_t(w) * slot.rows * sizeof(float);
+
+    // 颜色与深度放在同一个解包缓冲里，孤立旧存储避免等待上一轮传输
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.unpack);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(depthBytes + colorBytes), nullptr, GL_STREAM_DRAW);
+    auto *dst = static_cast<uint8_t *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(depthBytes + colorBytes),
+                                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    if (dst) {
+        // float 放在前面，保证 4 字节对齐；分块时逐行截取 [sx0, sx1)
+        for (int r = 0; r < slot.rows; ++r) {
+            size_t src = size_t(slot.y0 + r) * width_ + slot.sx0;
+            std::memcpy(dst + size_t(r) * w * sizeof(float), depth + src, size_t(w) * sizeof(float));
+            std::memcpy(dst + depthBytes + size_t(r) * w * 3, rgb + src * 3, size_t(w) * 3);
+        }
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        // 末尾不足一条时只更新前 rows 行，其余旧行各自独立计算，不影响有效行
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, slot.depth);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, slot.rows, GL_RED, GL_FLOAT, nullptr);
+        glBindTexture(GL_TEXTURE_2D, slot.color);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, slot.rows, GL_RGB, GL_UNSIGNED_BYTE,
+                        reinterpret_cast<const void *>(depthBytes));
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void StripeStreamer::readback(Slot &slot) {
+    TRACE_GPU_SCOPE("readback block");
+    // fill 末尾已打包成 RGB，复制到槽位的读回缓冲只是排进命令队列，CPU 不等待
+    pipeline_->copyOutput(slot.pack[0], slot.pack[1]);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StripeStreamer::drain(Slot &slot, uint8_t *left, uint8_t *right) {
+    if (!slot.fence) return;
+    TRACE_SCOPE("drain block");
+    glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    // 打包结果按本块宽度（含 halo）紧密排列，只取核心列
+    const int w = slot.sx1 - slot.sx0;
+    size_t bytes = size_t(w) * slot.rows * 3;
+    size_t coreBytes = size_t(slot.x1 - slot.x0) * 3;
+    uint8_t *outputs[2] = {left, right};
+    for (int eye = 0; eye < 2; ++eye) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pack[eye]);
+        const auto *src = static_cast<const uint8_t *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(bytes),
+                                                                        GL_MAP_READ_BIT));
+        if (src) {
+            for (int r = 0; r < slot.rows; ++r)
+                std::memcpy(outputs[eye] + (size_t(slot.y0 + r) * width_ + slot.x0) * 3,
+                            src + (size_t(r) * w + (slot.x0 - slot.sx0)) * 3, coreBytes);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void StripeStreamer::run(const uint8_t *rgb, const float *depth, int height, uint8_t *left, uint8_t *right) {
+    const int tile = StereoPipeline::TILE_W;
+    int stripes = (height + rows_ - 1) / rows_;
+    int columns = tileCols_ ? (width_ + tileCols_ - 1) / tileCols_ : 1;
+    int block = 0;
+    for (int s = 0; s < stripes; ++s) {
+        // 每条的第一块从空状态开始传播，与整幅处理的行首一致
+        if (tileCols_) {
+            clearTextureRGBA32UI(carry_[0], 0u, 0xFFFFFFFFu, 0u, 0u);
+            clearTextureRGBA32UI(carry_[1], 0u, 0xFFFFFFFFu, 0u, 0u);
+        }
+        for (int c = 0; c < columns; ++c, ++block) {
+            Slot &slot = slots_[block & 1];
+            // 槽位复用前先取走它上一轮的结果；通常上一块循环末尾已经取过
+            drain(slot, left, right);
+            slot.y0 = s * rows_;
+            slot.rows = std::min(rows_, height - slot.y0);
+            slot.x0 = tileCols_ ? c * tileCols_ : 0;
+            slot.x1 = tileCols_ ? std::min(width_, slot.x0 + tileCols_) : width_;
+            slot.sx0 = std::max(0, slot.x0 - halo_);
+            slot.sx1 = std::min(width_, slot.x1 + halo_);
+
+            upload(slot, rgb, depth);
+            pipeline_->resetTargets();
+            if (tileCols_) {
+                ColumnWindow window;
+                window.width = slot.sx1 - slot.sx0;
+                window.fullWidth = width_;
+                window.originX = slot.sx0;
+                window.tileBegin = (slot.x0 - slot.sx0) / tile;
+                window.tileEnd = (slot.x1 - slot.sx0 + tile - 1) / tile;
+                window.carryLeft = carry_[0];
+                window.carryRight = carry_[1];
+                pipeline_->setColumnWindow(window);
+            }
+            pipeline_->setSource(slot.color, slot.depth);
+            pipeline_->warp();
+            pipeline_->fill();
+            readback(slot);
+
+            // 上一块的读回在本块计算之前已排队，此时多半已经完成
+            if (block > 0) drain(slots_[(block - 1) & 1], left, right);
+        }
+    }
+    for (Slot &slot : slots_)
+        drain(slot, left, right);
+}
+
+void StripeStreamer::release() {
+    for (Slot &slot : slots_) {
+        if (slot.fence) glDeleteSync(slot.fence);
+        if (slot.color) glDeleteTextures(1, &slot.color);
+        if (slot.depth) glDeleteTextures(1, &slot.depth);
+        if (slot.unpack) glDeleteBuffers(1, &slot.unpack);
+        if (slot.pack[0]) glDeleteBuffers(2, slot.pack);
+        slot = Slot();
+    }
+    if (carry_[0]) glDeleteTextures(2, carry_);
+    carry_[0] = carry_[1] = 0;
+    pipeline_ = nullptr;
+}
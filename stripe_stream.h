@@ -0,0 +1,91 @@
+#pragma once
+// 行条带 / 列分块流式处理：warp / fill 只沿水平方向搬运像素，各行互不依赖，
+// 超出 GL_MAX_TEXTURE_SIZE / 工作组数上限（或显存预算）的图像按行条带依次处理，结果与整幅处理逐位一致
+// 目标纹理只按条带高度分配一次；源条带经解包缓冲上传、结果经打包缓冲异步读回，
+// 第 i 块的读回与第 i+1 块的上传和计算重叠，显存占用与图像高度无关
+//
+// 单行都超出纹理宽度时再按列分块：每块两侧各带 halo（补边宽度向上取整到 TILE_W）列源像素，
+// 核心列的 warp 结果与整幅一致；fill 的 tile 间传播状态经 carry 纹理从左块接力到右块，
+// 显存占用与图像宽度也无关
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+#include "stereo_pipeline.h"
+
+struct GLLimits {
+    int maxTextureSize = 0;
+    int maxWorkGroupCount[2] = {0, 0};
+};
+GLLimits queryGLLimits();
+
+// 显存规划（TilePrefix，分离输入 RGB8 + R32F）：整幅处理的峰值超出预算时改为按条带处理，
+// 条带高度按预算选取；连一行都放不下（或不允许条带）时 fits 为 false，调用方应拒绝该任务
+struct VramPlan {
+    size_t targetBytes = 0; // 整幅目标纹理（两眼，按变体含竞争键 / edge）
+    size_t sourceBytes = 0; // 整幅源纹理
+    int stripeRows = 0;     // 超出预算时的条带高度；0 表示整幅处理
+    size_t stripeBytes = 0; // 条带处理的峰值（目标 + 双缓冲源纹理与像素缓冲）
+    bool fits = true;
+    size_t frameBytes() const { return targetBytes + sourceBytes; }
+};
+// budgetBytes 为 0 表示不限；需要当前 GL 上下文（条带高度还受纹理 / 工作组上限约束）。
+// 目标纹理按 warp / color 实际分配的计算（Splat 另含累加缓冲，单趟 warp 与 Mesh 没有竞争键），
+// interleaveEyes 与 StereoPipeline::setInterleaveEyes 一致（false 时竞争键 / edge 只算一份）
+VramPlan planVram(int width, int height, size_t budgetBytes, bool canStripe = true,
+                  ColorResolve color = ColorResolve::Eager, WarpVariant warp = WarpVariant::Scatter,
+                  bool interleaveEyes = true);
+void printVramPlan(std::ostream &os, const VramPlan &plan, int width, int height, size_t budgetBytes);
+
+class StripeStreamer {
+public:
+    // 一行占用的显存：目标纹理 + 双缓冲的源纹理与像素缓冲
+    static size_t bytesPerRow(int width, ColorResolve color = ColorResolve::Eager,
+                              WarpVariant warp = WarpVariant::Scatter, bool interleaveEyes = true);
+    // 选择条带高度：requested > 0 时不超过它；否则整幅放得下就不拆。budgetBytes > 0 时再按预算限制
+    // 宽度本身超出上限（或预算连一行都放不下）时返回 0
+    static int chooseRows(int width, int height, int requested = 0, size_t budgetBytes = 0,
+                          ColorResolve color = ColorResolve::Eager, WarpVariant warp = WarpVariant::Scatter,
+                          bool interleaveEyes = true);
+    // 选择列块核心宽度（TILE_W 的倍数）：整幅宽度放得下且未指定 requested 时返回 0（不分块），
+    // 上限减去两侧 halo 后放不下一个 tile 时返回 -1
+    static int chooseTileCols(int width, int halo, int requested = 0);
+    // 列块两侧 halo：补边宽度向上取整到 TILE_W，保证块内 tile 网格与整幅对齐
+    static int haloFor(const StereoPipeline &pipeline, int width);
+    // 一块纹理的宽度
+    static int blockWidth(int width, int tileCols, int halo);
+
+    // pipeline 须已 loadPrograms（streamable()：Scatter / Gather / RowScatter + TilePrefix，源为 RGB + R32F）、
+    // setOutputFormat(OutputFormat::RGB) 并 setParams；其它变体（Mesh、SplitPass 系列）返回 false。
+    // tileCols > 0 时按列分块（TILE_W 的倍数），还要求 columnTileable()（不支持延迟取色）
+    bool begin(StereoPipeline &pipeline, int width, int stripeRows, int tileCols = 0);
+    // rgb：RGB8，depth：float，left / right：RGB8 输出；均为 width x height、行紧密排列
+    void run(const uint8_t *rgb, const float *depth, int height, uint8_t *left, uint8_t *right);
+    void release();
+
+    int stripeRows() const { return rows_; }
+    int tileCols() const { return tileCols_; }
+
+private:
+    struct Slot {
+        GLuint color = 0, depth = 0; // 源块
+        GLuint unpack = 0;
+        GLuint pack[2] = {0, 0};     // 左 / 右眼读回
+        GLsync fence = nullptr;
+        int y0 = 0, rows = 0;
+        int x0 = 0, x1 = 0;   // 核心列（写入输出）
+        int sx0 = 0, sx1 = 0; // 源列（含 halo）
+    };
+
+    void upload(Slot &slot, const uint8_t *rgb, const float *depth);
+    void readback(Slot &slot);
+    void drain(Slot &slot, uint8_t *left, uint8_t *right);
+
+    StereoPipeline *pipeline_ = nullptr;
+    int width_ = 0, rows_ = 0;
+    int tileCols_ = 0, halo_ = 0, texWidth_ = 0;
+    GLuint carry_[2] = {0, 0}; // 左 / 右眼的行传播状态
+    Slot slots_[2];
+};
@@ -0,0 +1,96 @@
+#include "synthetic_scenes.h"
+
+#include <algorithm>
+#include <random>
+
+const char *sceneName(SceneKind kind) {
+    switch (kind) {
+    case SceneKind::Plane: return "plane";
+    case SceneKind::Ramp: return "ramp";
+    case SceneKind::Steps: return "steps";
+    case SceneKind::Occlusion: return "occlusion";
+    }
+    return "?";
+}
+
+bool parseSceneKind(const std::string &name, SceneKind &kind) {
+    for (SceneKind k : {SceneKind::Plane, SceneKind::Ramp, SceneKind::Steps, SceneKind::Occlusion}) {
+        if (name == sceneName(k)) {
+            kind = k;
+            return true;
+        }
+    }
+    return false;
+}
+
+RGBDImage generateScene(SceneKind kind, int width, int height, uint32_t seed) {
+    RGBDImage scene;
+    scene.width = width;
+    scene.height = height;
+    scene.rgb.resize(size_t(width) * height * 3);
+    scene.depth.assign(size_t(width) * height, 0.0f);
+
+    // 颜色：棋盘格 + 渐变，保证填充结果可辨且不可压缩为常量
+    const int cell = std::max(8, width / 64);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint8_t *p = &scene.rgb[(size_t(y) * width + x) * 3];
+            bool odd = ((x / cell) + (y / cell)) & 1;
+            p[0] = uint8_t(255 * x / std::max(1, width - 1));
+            p[1] = uint8_t(255 * y / std::max(1, height - 1));
+            p[2] = odd ? 224 : 32;
+        }
+    }
+
+    float *d = scene.depth.data();
+    switch (kind) {
+    case SceneKind::Plane:
+        std::fill(scene.depth.begin(), scene.depth.end(), 0.5f);
+        break;
+    case SceneKind::Ramp:
+        for (int y = 0; y < height; ++y)
+            for (int x = 0; x < width; ++x)
+                d[size_t(y) * width + x] = float(x) / std::max(1, width - 1);
+        break;
+    case SceneKind::Steps: {
+        const int bands = 8;
+        for (int y = 0; y < height; ++y)
+            for (int x = 0; x < width; ++x) {
+                int band = x * bands / width;
+                d[size_t(y) * width + x] = (band & 1) ? 1.0f : 0.25f + 0.05f * band;
+            }
+        break;
+    }
+    case SceneKind::Occlusion: {
+        // 背景远平面 + 由远到近叠放的随机矩形，近处覆盖远处
+        std::mt19937 rng(seed);
+        std::fill(scene.depth.begin(), scene.depth.end(), 0.1f);
+        const int count = 64;
+        for (int i = 0; i < count; ++i) {
+            int rw = std::uniform_int_distribution<int>(width / 32, width / 6)(rng);
+            int rh = std::uniform_int_distribution<int>(height / 32, height / 3)(rng);
+            int rx = std::uniform_int_distribution<int>(0, width - rw)(rng);
+            int ry = std::uniform_int_distribution<int>(0, height - rh)(rng);
+            float z = 0.1f + 0.9f * float(i + 1) / count;
+            for (int y = ry; y < ry + rh; ++y)
+                std::fill(d + size_t(y) * width + rx, d + size_t(y) * width + rx + rw, z);
+        }
+        break;
+    }
+    }
+    return scene;
+}
+
+std::vector<uint8_t> packSideBySide(const RGBDImage &scene) {
+    const int w = scene.width, h = scene.height;
+    std::vector<uint8_t> sbs(size_t(w) * 2 * h * 3, 0);
+    for (int y = 0; y < h; ++y) {
+        uint8_t *row = &sbs[size_t(y) * w * 2 * 3];
+        std::copy_n(&scene.rgb[size_t(y) * w * 3], size_t(w) * 3, row);
+        for (int x = 0; x < w; ++x) {
+            float z = std::min(std::max(scene.depth[size_t(y) * w + x], 0.0f), 1.0f);
+            row[(w + x) * 3] = uint8_t(z * 255.0f + 0.5f);
+        }
+    }
+    return sbs;
+}
@@ -0,0 +1,29 @@
+#pragma once
+// 合成 RGB-D 场景：供 stereogen_bench 生成与分辨率无关、可复现的输入
+// 深度约定与 depth.exr 一致：0‥1，越大越近（位移越大）
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class SceneKind {
+    Plane,     // 单一深度平面：无遮挡，只有边缘空洞
+    Ramp,      // 水平深度斜坡：位移逐列变化，拉伸/压缩
+    Steps,     // 竖条阶梯：规则的深度跳变
+    Occlusion, // 随机矩形堆叠：大量遮挡与空洞
+};
+
+struct RGBDImage {
+    int width = 0, height = 0;
+    std::vector<uint8_t> rgb; // RGB8，行紧密排列
+    std::vector<float> depth; // R32F
+};
+
+const char *sceneName(SceneKind kind);
+bool parseSceneKind(const std::string &name, SceneKind &kind);
+
+// 生成 width x height 的场景，seed 只影响 Occlusion
+RGBDImage generateScene(SceneKind kind, int width, int height, uint32_t seed = 1);
+
+// 打包为 SBS（左半颜色、右半 R 通道为 8 位深度），供 SplitPass 使用
+std::vector<uint8_t> packSideBySide(const RGBDImage &scene);
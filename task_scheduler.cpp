@@ -0,0 +1,97 @@
+#include "task_scheduler.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "trace.h"
+
+namespace {
+thread_local int tWorker = -1; // 当前线程的工作线程编号，非工作线程为 -1
+}
+
+TaskScheduler::TaskScheduler(int workers) : stats_(size_t(workers < 1 ? 1 : workers)) {
+    for (size_t i = 0; i < stats_.size(); ++i)
+        queues_.push_back(std::make_unique<Queue>());
+}
+
+void TaskScheduler::submit(Task task) {
+    int target = tWorker >= 0 ? tWorker : int(nextQueue_++ % queues_.size());
+    pending_++;
+    {
+        std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+        queues_[target]->tasks.push_back(std::move(task));
+    }
+    queued_++;
+    // 先改计数再在锁内通知，等待方检查条件时不会漏掉
+    { std::lock_guard<std::mutex> lock(idleMutex_); }
+    idleCv_.notify_all();
+}
+
+bool TaskScheduler::popLocal(int worker, Task &task) {
+    Queue &q = *queues_[worker];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) return false;
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    queued_--;
+    return true;
+}
+
+bool TaskScheduler::steal(int worker, Task &task) {
+    int n = int(queues_.size());
+    for (int i = 1; i < n; ++i) {
+        Queue &q = *queues_[(worker + i) % n];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) continue;
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        queued_--;
+        return true;
+    }
+    return false;
+}
+
+void TaskScheduler::workerLoop(int worker) {
+    WorkerStats &stats = stats_[worker];
+    auto start = std::chrono::steady_clock::now();
+    while (true) {
+        Task task;
+        bool stolen = false;
+        if (!popLocal(worker, task)) stolen = steal(worker, task);
+        if (task) {
+            auto t0 = std::chrono::steady_clock::now();
+            task(worker);
+            stats.busyMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            stats.tasks++;
+            stats.stolen += stolen ? 1 : 0;
+            if (--pending_ == 0) {
+                { std::lock_guard<std::mutex> lock(idleMutex_); }
+                idleCv_.notify_all();
+            }
+            continue;
+        }
+        // 没有可取的任务：等新任务提交，或所有任务完成
+        std::unique_lock<std::mutex> lock(idleMutex_);
+        idleCv_.wait(lock, [this] { return queued_ > 0 || pending_ == 0; });
+        if (pending_ == 0) break;
+    }
+    stats.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TaskScheduler::run(const std::function<bool(int)> &initWorker, const std::function<void(int)> &finishWorker) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workerCount(); ++i) {
+        threads.emplace_back([this, i, &initWorker, &finishWorker] {
+            tWorker = i;
+            std::string name = "worker " + std::to_string(i);
+            traceThreadName(name.c_str());
+            stats_[i].ready = initWorker(i);
+            if (stats_[i].ready) workerLoop(i);
+            finishWorker(i);
+            tWorker = -1;
+        });
+    }
+    for (std::thread &t : threads)
+        t.join();
+}
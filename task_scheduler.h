@@ -0,0 +1,57 @@
+#pragma once
+// 工作窃取任务调度：每个工作线程一个双端队列，自己从队尾取（后提交的先做，数据还在缓存里），
+// 空闲时从其他线程的队首偷最早的任务。任务执行中可以继续 submit（例如把大图拆成条带），
+// 新任务进入当前线程的队列，其他空闲线程会把它们偷走
+//
+// 每个工作线程在开始 / 结束时调用 initWorker / finishWorker，用于绑定和释放各自的 GL 上下文
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class TaskScheduler {
+public:
+    using Task = std::function<void(int worker)>;
+
+    struct WorkerStats {
+        int tasks = 0;       // 执行的任务数
+        int stolen = 0;      // 其中从其他队列偷来的
+        double busyMs = 0;   // 执行任务的累计时间
+        double wallMs = 0;   // 线程从开始取任务到退出
+        bool ready = true;   // initWorker 是否成功
+        double utilization() const { return wallMs > 0 ? busyMs / wallMs : 0; }
+    };
+
+    explicit TaskScheduler(int workers);
+
+    // 工作线程内提交到自己的队列；其他线程提交时轮流分配
+    void submit(Task task);
+    // 启动工作线程，执行到所有任务（包括执行中新提交的）完成后返回
+    // initWorker 返回 false 的线程不取任务
+    void run(const std::function<bool(int)> &initWorker, const std::function<void(int)> &finishWorker);
+
+    int workerCount() const { return int(queues_.size()); }
+    const std::vector<WorkerStats> &stats() const { return stats_; }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool popLocal(int worker, Task &task);
+    bool steal(int worker, Task &task);
+    void workerLoop(int worker);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<WorkerStats> stats_;
+    std::atomic<int> pending_{0}; // 已提交、未完成
+    std::atomic<int> queued_{0};  // 还在队列里
+    std::atomic<unsigned> nextQueue_{0};
+    std::mutex idleMutex_;
+    std::condition_variable idleCv_;
+};
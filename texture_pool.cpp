@@ -0,0 +1,82 @@
+#include "texture_pool.h"
+
+#include <algorithm>
+
+size_t TexturePool::bytesPerTexel(GLenum format) {
+    switch (format) {
+    case GL_R8:
+    case GL_R8UI: return 1;
+    case GL_RG8: return 2;
+    case GL_RGB8:
+    case GL_RGBA8:
+    case GL_R32F:
+    case GL_R32UI:
+    case GL_DEPTH_COMPONENT32F: return 4;
+    case GL_RG32F:
+    case GL_RG32UI: return 8;
+    case GL_RGBA32F:
+    case GL_RGBA32UI: return 16;
+    }
+    return 4;
+}
+
+size_t TexturePool::textureBytes(GLenum format, int width, int height) {
+    return bytesPerTexel(format) * size_t(width) * size_t(height);
+}
+
+GLuint TexturePool::acquire(GLenum format, int width, int height) {
+    Key key{format, width, height};
+    size_t bytes = textureBytes(format, width, height);
+    GLuint tex = 0;
+
+    // 从最近归还的开始找，刚用过的尺寸最可能再次出现
+    for (size_t i = free_.size(); i-- > 0;) {
+        if (free_[i].key == key) {
+            tex = free_[i].tex;
+            free_.erase(free_.begin() + long(i));
+            freeBytes_ -= bytes;
+            ++hits_;
+            break;
+        }
+    }
+    if (!tex) {
+        glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+        ++misses_;
+    }
+
+    live_[tex] = key;
+    liveBytes_ += bytes;
+    peakBytes_ = std::max(peakBytes_, liveBytes_ + freeBytes_);
+    return tex;
+}
+
+void TexturePool::recycle(GLuint tex) {
+    auto it = live_.find(tex);
+    if (it == live_.end()) return;
+    size_t bytes = textureBytes(it->second.format, it->second.width, it->second.height);
+    free_.push_back({tex, it->second});
+    live_.erase(it);
+    liveBytes_ -= bytes;
+    freeBytes_ += bytes;
+}
+
+void TexturePool::trim(size_t maxFreeBytes) {
+    size_t drop = 0;
+    while (drop < free_.size() && freeBytes_ > maxFreeBytes) {
+        const Key &key = free_[drop].key;
+        freeBytes_ -= textureBytes(key.format, key.width, key.height);
+        glDeleteTextures(1, &free_[drop].tex);
+        ++drop;
+    }
+    free_.erase(free_.begin(), free_.begin() + long(drop));
+}
+
+void TexturePool::release() {
+    trim(0);
+    for (auto &entry : live_)
+        glDeleteTextures(1, &entry.first);
+    live_.clear();
+    liveBytes_ = 0;
+}
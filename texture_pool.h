@@ -0,0 +1,48 @@
+#pragma once
+// 纹理池：按 (格式, 宽, 高) 回收和复用不可变存储纹理（glTexStorage2D）
+// 尺寸在请求之间来回切换时（daemon / C API），已分配过的尺寸直接取回，不再重新分配显存；
+// 空闲纹理按最近使用保留，超出 trim 上限的最旧者先删除
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class TexturePool {
+public:
+    // 每像素显存估计；RGB8 按驱动通常的 4 字节对齐存储计
+    static size_t bytesPerTexel(GLenum format);
+    static size_t textureBytes(GLenum format, int width, int height);
+
+    // 取一张纹理：优先复用同格式同尺寸的空闲纹理（内容未定义），否则新建
+    GLuint acquire(GLenum format, int width, int height);
+    // 归还 acquire 得到的纹理，0 被忽略
+    void recycle(GLuint tex);
+    // 删除最久未用的空闲纹理，直到空闲部分不超过 maxFreeBytes
+    void trim(size_t maxFreeBytes);
+    // 删除所有纹理（包括未归还的）
+    void release();
+
+    size_t liveBytes() const { return liveBytes_; }
+    size_t freeBytes() const { return freeBytes_; }
+    size_t peakBytes() const { return peakBytes_; }
+    int hits() const { return hits_; }
+    int misses() const { return misses_; }
+
+private:
+    struct Key {
+        GLenum format = 0;
+        int width = 0, height = 0;
+        bool operator==(const Key &o) const { return format == o.format && width == o.width && height == o.height; }
+    };
+    struct FreeEntry {
+        GLuint tex;
+        Key key;
+    };
+
+    std::vector<FreeEntry> free_;           // 按归还顺序，队首最旧
+    std::unordered_map<GLuint, Key> live_;  // 已取出
+    size_t liveBytes_ = 0, freeBytes_ = 0, peakBytes_ = 0;
+    int hits_ = 0, misses_ = 0;
+};
@@ -0,0 +1,200 @@
+#include "trace.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int CPU_PID = 1;
+const int GPU_PID = 2;
+const size_t MAX_PENDING_GPU = 256; // 查询池上限，满了就同步取一次结果
+
+struct TraceEvent {
+    std::string name;
+    int pid, tid;
+    double tsUs, durUs;
+};
+
+std::atomic<bool> gEnabled{false};
+std::mutex gMutex;
+std::string gPath;
+TraceClock::time_point gOrigin;
+std::vector<TraceEvent> gEvents;
+std::map<std::thread::id, int> gThreadIds;
+std::map<int, std::string> gThreadNames;
+
+// 查询对象属于各自的 GL 上下文，GPU 状态按线程保存
+struct GpuTraceState {
+    bool calibrated = false;
+    GLint64 gpuBase = 0;
+    double cpuBaseUs = 0;
+    struct Pending {
+        const char *name;
+        GLuint begin, end;
+    };
+    std::vector<Pending> pending;
+    std::vector<GLuint> freeQueries;
+};
+thread_local GpuTraceState tGpu;
+
+double toUs(TraceClock::time_point t) {
+    return std::chrono::duration<double, std::micro>(t - gOrigin).count();
+}
+
+// 调用方持有 gMutex
+int threadIdLocked() {
+    auto it = gThreadIds.find(std::this_thread::get_id());
+    if (it != gThreadIds.end()) return it->second;
+    int id = int(gThreadIds.size()) + 1;
+    gThreadIds[std::this_thread::get_id()] = id;
+    return id;
+}
+
+void pushEvent(const char *name, int pid, double tsUs, double durUs) {
+    std::lock_guard<std::mutex> lock(gMutex);
+    gEvents.push_back({name, pid, threadIdLocked(), tsUs, durUs});
+}
+
+GLuint acquireQuery() {
+    if (!tGpu.freeQueries.empty()) {
+        GLuint q = tGpu.freeQueries.back();
+        tGpu.freeQueries.pop_back();
+        return q;
+    }
+    GLuint q;
+    glGenQueries(1, &q);
+    return q;
+}
+
+// 取回本线程所有未完成的 GPU 区间
+void resolvePendingGpu() {
+    for (const GpuTraceState::Pending &p : tGpu.pending) {
+        GLuint64 t0 = 0, t1 = 0;
+        glGetQueryObjectui64v(p.begin, GL_QUERY_RESULT, &t0);
+        glGetQueryObjectui64v(p.end, GL_QUERY_RESULT, &t1);
+        double ts = tGpu.cpuBaseUs + (GLint64(t0) - tGpu.gpuBase) / 1000.0;
+        pushEvent(p.name, GPU_PID, ts, (t1 - t0) / 1000.0);
+        tGpu.freeQueries.push_back(p.begin);
+        tGpu.freeQueries.push_back(p.end);
+    }
+    tGpu.pending.clear();
+}
+
+std::string jsonEscape(const std::string &s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+} // namespace
+
+bool traceInit(const std::string &path) {
+    std::string file = path;
+    if (file.empty()) {
+        const char *env = std::getenv("STEREOGEN_TRACE");
+        if (env) file = env;
+    }
+    if (file.empty()) return false;
+
+    std::lock_guard<std::mutex> lock(gMutex);
+    gPath = file;
+    gOrigin = TraceClock::now();
+    gEvents.clear();
+    gEvents.reserve(4096);
+    gThreadNames[threadIdLocked()] = "main";
+    gEnabled.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+bool traceEnabled() {
+    return gEnabled.load(std::memory_order_relaxed);
+}
+
+void traceFlushGpu() {
+    if (!traceEnabled()) return;
+    resolvePendingGpu();
+    for (GLuint q : tGpu.freeQueries)
+        glDeleteQueries(1, &q);
+    tGpu.freeQueries.clear();
+    tGpu.calibrated = false;
+}
+
+void traceShutdown() {
+    if (!traceEnabled()) return;
+    traceFlushGpu();
+
+    gEnabled.store(false, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(gMutex);
+    std::ofstream f(gPath);
+    if (!f) {
+        std::cerr << "Cannot write trace: " << gPath << std::endl;
+        return;
+    }
+
+    char buf[64];
+    f << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    f << "{\"ph\": \"M\", \"name\": \"process_name\", \"pid\": " << CPU_PID << ", \"args\": {\"name\": \"CPU\"}},\n";
+    f << "{\"ph\": \"M\", \"name\": \"process_name\", \"pid\": " << GPU_PID << ", \"args\": {\"name\": \"GPU\"}}";
+    for (const auto &t : gThreadNames) {
+        for (int pid : {CPU_PID, GPU_PID})
+            f << ",\n{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": " << pid << ", \"tid\": " << t.first
+              << ", \"args\": {\"name\": \"" << jsonEscape(t.second) << "\"}}";
+    }
+    for (const TraceEvent &e : gEvents) {
+        std::snprintf(buf, sizeof(buf), "\"ts\": %.3f, \"dur\": %.3f", e.tsUs, e.durUs);
+        f << ",\n{\"ph\": \"X\", \"name\": \"" << jsonEscape(e.name) << "\", \"pid\": " << e.pid
+          << ", \"tid\": " << e.tid << ", " << buf << "}";
+    }
+    f << "\n]}\n";
+    std::cout << "Trace written: " << gPath << " (" << gEvents.size() << " events)" << std::endl;
+    gEvents.clear();
+}
+
+void traceCpuSpan(const char *name, TraceClock::time_point begin, TraceClock::time_point end) {
+    if (!traceEnabled()) return;
+    pushEvent(name, CPU_PID, toUs(begin), std::chrono::duration<double, std::micro>(end - begin).count());
+}
+
+void traceThreadName(const char *name) {
+    if (!traceEnabled()) return;
+    std::lock_guard<std::mutex> lock(gMutex);
+    gThreadNames[threadIdLocked()] = name;
+}
+
+TraceScope::TraceScope(const char *name) : name_(name), active_(traceEnabled()) {
+    if (active_) begin_ = TraceClock::now();
+}
+
+TraceScope::~TraceScope() {
+    if (active_) traceCpuSpan(name_, begin_, TraceClock::now());
+}
+
+GpuTraceScope::GpuTraceScope(const char *name) : name_(name) {
+    if (!traceEnabled()) return;
+    if (!tGpu.calibrated) {
+        // 同一时刻采样 GPU / CPU 时钟，之后的 GPU 时间戳都按这个偏移换算
+        glGetInteger64v(GL_TIMESTAMP, &tGpu.gpuBase);
+        tGpu.cpuBaseUs = toUs(TraceClock::now());
+        tGpu.calibrated = true;
+    }
+    begin_ = acquireQuery();
+    glQueryCounter(begin_, GL_TIMESTAMP);
+}
+
+GpuTraceScope::~GpuTraceScope() {
+    if (!begin_) return;
+    GLuint end = acquireQuery();
+    glQueryCounter(end, GL_TIMESTAMP);
+    tGpu.pending.push_back({name_, begin_, end});
+    if (tGpu.pending.size() >= MAX_PENDING_GPU) resolvePendingGpu();
+}
@@ -0,0 +1,60 @@
+#pragma once
+// Chrome trace-event / Perfetto 时间线导出
+// 环境变量 STEREOGEN_TRACE=<file.json>（或可执行文件的 --trace 参数）开启；
+// 关闭时每个作用域只有一次 relaxed 原子读，不取时间、不发 GL 查询
+//
+// CPU 作用域按线程分轨（pid 1），GPU 时间戳查询区间单独一条轨（pid 2），
+// GPU 时间通过开启时的一次 GL_TIMESTAMP 采样对齐到 CPU 时钟
+// 用 chrome://tracing 或 ui.perfetto.dev 打开输出文件
+
+#include <glad/glad.h>
+#include <chrono>
+#include <string>
+
+using TraceClock = std::chrono::steady_clock;
+
+// path 为空时读取 STEREOGEN_TRACE；返回是否开启
+bool traceInit(const std::string &path = "");
+// 解析所有未完成的 GPU 查询并写出文件（需在 GL 上下文销毁前调用）
+void traceShutdown();
+// 取回本线程的 GPU 查询并释放查询对象；其他持有 GL 上下文的线程在销毁上下文前调用
+void traceFlushGpu();
+bool traceEnabled();
+
+// 记录一段已结束的 CPU 区间（供已有计时代码直接上报）
+void traceCpuSpan(const char *name, TraceClock::time_point begin, TraceClock::time_point end);
+// 当前线程在时间线上的名字
+void traceThreadName(const char *name);
+
+// CPU 作用域：构造到析构
+class TraceScope {
+public:
+    explicit TraceScope(const char *name);
+    ~TraceScope();
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *name_;
+    bool active_;
+    TraceClock::time_point begin_;
+};
+
+// GPU 作用域：构造/析构各插入一个 GL_TIMESTAMP 查询，结果延迟到 traceShutdown 或查询池满时再取，
+// 不会让 CPU 等待 GPU。必须在拥有当前 GL 上下文的线程使用
+class GpuTraceScope {
+public:
+    explicit GpuTraceScope(const char *name);
+    ~GpuTraceScope();
+    GpuTraceScope(const GpuTraceScope &) = delete;
+    GpuTraceScope &operator=(const GpuTraceScope &) = delete;
+
+private:
+    const char *name_;
+    GLuint begin_ = 0;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_GPU_SCOPE(name) GpuTraceScope TRACE_CONCAT(gpuTraceScope_, __LINE__)(name)
@@ -0,0 +1,22 @@
+#version 430 core
+// 片元着色器：行网格 warp 的取色
+// 普通段按插值出的源列最近取整（与 scatter 的投射一致）；拉伸段整段取较远一端的源像素，
+// 相当于用背景延伸填补露出的区域。输出颜色（attachment 0）和源列索引（attachment 1，R32UI）
+layout(binding = 0) uniform sampler2D srcColor;
+
+uniform int orgWidth;
+uniform int padSize;
+
+in float vSrc;
+flat in int vStretch;
+flat in int vBackSrc;
+
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out uint outIndex;
+
+void main(){
+    int y    = int(gl_FragCoord.y);
+    int srcX = vStretch != 0 ? vBackSrc : clamp(int(floor(vSrc + 0.5)) - padSize, 0, orgWidth-1);
+    outColor = vec4(texelFetch(srcColor, ivec2(srcX, y), 0).rgb, 1.0);
+    outIndex = uint(srcX);
+}
@@ -0,0 +1,46 @@
+#version 430 core
+// 顶点着色器：行网格 warp（光栅化替代 warp + fill）
+// 每行源像素（padded 列 g，两侧按边缘列复制）连成一条三角形带：每列上下两个顶点，实例号为行号，不需要顶点缓冲。
+// 顶点水平位置为源像素中心投射后的位置 g + disp + 0.5 - padSize，深度直接作为片元深度，硬件深度测试（GEQUAL）
+// 让近处表面胜出；前景 / 背景之间被拉开的四边形盖住原本的空洞，因此不需要 fill
+//
+// 三角形带里四边形 [g-1, g] 的两个三角形都以第 g 列的顶点为 provoking vertex，flat 输出按这一段计算：
+// 段宽超过 2 像素（scatter 的两像素足迹在此会留下空洞）时视为拉伸段，片元取两端中较远（深度小）的源像素
+layout(binding = 0) uniform sampler2D srcColor;   // 深度的读取与归一化见 depth_decode.glsl（宿主插入）
+
+uniform int   orgWidth;
+uniform int   orgHeight;
+uniform int   padSize;
+uniform float shiftScale;
+uniform float shiftBias;
+
+out float vSrc;               // 源列（padded），片元按最近取整
+flat out int vStretch;        // 1：拉伸段
+flat out int vBackSrc;        // 拉伸段较远一端的源列（未补边坐标）
+
+const float STRETCH = 2.0;
+
+void main(){
+    int g = gl_VertexID >> 1;
+    int y = gl_InstanceID;
+
+    int   srcX = clamp(g - padSize, 0, orgWidth-1);
+    float Z    = loadDepth(ivec2(srcX, y));
+    float x    = float(g) + Z*shiftScale + shiftBias + 0.5 - float(padSize);
+
+    vStretch = 0;
+    vBackSrc = srcX;
+    if(g > 0){
+        int   prevX = clamp(g - 1 - padSize, 0, orgWidth-1);
+        float prevZ = loadDepth(ivec2(prevX, y));
+        float prevXp = float(g - 1) + prevZ*shiftScale + shiftBias + 0.5 - float(padSize);
+        if(x - prevXp > STRETCH){
+            vStretch = 1;
+            vBackSrc = prevZ < Z ? prevX : srcX;
+        }
+    }
+    vSrc = float(g);
+
+    float row = float(y + (gl_VertexID & 1));
+    gl_Position = vec4(x / float(orgWidth) * 2.0 - 1.0, row / float(orgHeight) * 2.0 - 1.0, Z * 2.0 - 1.0, 1.0);
+}